@@ -46,8 +46,12 @@ std::string Location::ToString() const {
 		return std::string(function_name_) + "@" + file_name_ + ":" +
 			std::to_string(line_number_);
 	}
-	//return printf("pc:%p", program_counter_);
-	return std::string(reinterpret_cast<const char*>(program_counter_));
+	// FROM_HERE只记录了文件名.
+	char pc[32];
+	snprintf(pc, sizeof(pc), "pc:%p", program_counter_);
+	if (file_name_)
+		return std::string(file_name_) + "@" + pc;
+	return pc;
 }
 
 #if defined(COMPILER_MSVC)
@@ -23,6 +23,7 @@ class BASE_EXPORT Location {
  public:
 	 Location();
 	 Location(const Location& other);
+	 Location& operator=(const Location& other) = default;
 
 	 // 只初始化file name 和 program counter
 	 Location(const char* file_name, const void* program_counter);
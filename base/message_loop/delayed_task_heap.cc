@@ -0,0 +1,93 @@
+﻿/**
+* @Author: YangGuang
+* @Date:   2026-10-17
+* @Email:  guang334419520@126.com
+* @Filename: delayed_task_heap.cc
+* @Last modified by:  YangGuang
+*/
+#include "base/message_loop/delayed_task_heap.h"
+
+#include <utility>
+
+#include "base/logging.h"
+
+namespace base {
+
+namespace internal {
+
+DelayedTaskHeap::DelayedTaskHeap() = default;
+
+DelayedTaskHeap::~DelayedTaskHeap() = default;
+
+void DelayedTaskHeap::Push(PendingTask pending_task) {
+	heap_.push_back(std::move(pending_task));
+	SiftUp(heap_.size() - 1);
+}
+
+const PendingTask& DelayedTaskHeap::Peek() const {
+	DCHECK(!heap_.empty());
+	return heap_.front();
+}
+
+PendingTask DelayedTaskHeap::Pop() {
+	return Erase(0);
+}
+
+PendingTask DelayedTaskHeap::Erase(std::size_t index) {
+	DCHECK_LT(index, heap_.size());
+	PendingTask pending_task = std::move(heap_[index]);
+
+	const std::size_t last = heap_.size() - 1;
+	if (index != last) {
+		// 用最后一个任务填上空出来的位置, 它可能比原来的任务早也可能比它晚.
+		heap_[index] = std::move(heap_[last]);
+		heap_.pop_back();
+		SiftUp(index);
+		SiftDown(index);
+	}
+	else {
+		heap_.pop_back();
+	}
+	return pending_task;
+}
+
+void DelayedTaskHeap::SiftUp(std::size_t index) {
+	while (index > 0) {
+		const std::size_t parent = (index - 1) / 2;
+		// PendingTask::operator< 表示运行得更晚.
+		if (!(heap_[parent] < heap_[index]))
+			break;
+		std::swap(heap_[parent], heap_[index]);
+		UpdateIndex(index);
+		index = parent;
+	}
+	UpdateIndex(index);
+}
+
+void DelayedTaskHeap::SiftDown(std::size_t index) {
+	const std::size_t size = heap_.size();
+	for (;;) {
+		std::size_t earliest = index;
+		const std::size_t left = index * 2 + 1;
+		const std::size_t right = left + 1;
+		if (left < size && heap_[earliest] < heap_[left])
+			earliest = left;
+		if (right < size && heap_[earliest] < heap_[right])
+			earliest = right;
+		if (earliest == index)
+			break;
+		std::swap(heap_[index], heap_[earliest]);
+		UpdateIndex(index);
+		index = earliest;
+	}
+	UpdateIndex(index);
+}
+
+void DelayedTaskHeap::UpdateIndex(std::size_t index) {
+	if (heap_[index].cancel_state)
+		heap_[index].cancel_state->heap_index = index;
+}
+
+}	// namespace internal.
+
+}	// namespace base.
@@ -0,0 +1,64 @@
+﻿/**
+* @Author: YangGuang
+* @Date:   2026-10-17
+* @Email:  guang334419520@126.com
+* @Filename: delayed_task_heap.h
+* @Last modified by:  YangGuang
+*/
+#ifndef BASE_MESSAGE_LOOP_DELAYED_TASK_HEAP_H
+#define BASE_MESSAGE_LOOP_DELAYED_TASK_HEAP_H
+
+#include <stddef.h>
+
+#include <vector>
+
+#include "base/base_export.h"
+#include "base/macor.h"
+#include "base/pending_task.h"
+
+namespace base {
+
+namespace internal {
+
+// 保存延迟任务的二叉堆, 最早的任务(按照delayed_run_time, 然后sequence_num)在
+// 堆顶. 和std::priority_queue不同的是, 任务移动的时候会更新它的
+// |cancel_state->heap_index|, 所以可以用Erase()在O(log n)里面删除堆中间的任务.
+//
+// 只能在一个线程上使用.
+class BASE_EXPORT DelayedTaskHeap {
+ public:
+	 DelayedTaskHeap();
+	 ~DelayedTaskHeap();
+
+	 void Push(PendingTask pending_task);
+
+	 // 返回最早的任务, 堆不能为空.
+	 const PendingTask& Peek() const;
+
+	 // 删除并且返回最早的任务, 堆不能为空.
+	 PendingTask Pop();
+
+	 // 删除并且返回下标为|index|的任务.
+	 PendingTask Erase(std::size_t index);
+
+	 bool empty() const { return heap_.empty(); }
+	 std::size_t size() const { return heap_.size(); }
+
+ private:
+	 // 把|index|上的任务往上或者往下移动到正确的位置.
+	 void SiftUp(std::size_t index);
+	 void SiftDown(std::size_t index);
+
+	 // 把|heap_[index]|的新位置告诉它的cancel_state.
+	 void UpdateIndex(std::size_t index);
+
+	 std::vector<PendingTask> heap_;
+
+	 DISALLOW_COPY_AND_ASSIGN(DelayedTaskHeap);
+};
+
+}	// namespace internal.
+
+}	// namespace base.
+
+#endif // !BASE_MESSAGE_LOOP_DELAYED_TASK_HEAP_H
@@ -7,7 +7,11 @@
 */
 
 #include "base/message_loop/incoming_task_queue.h"
+
+#include <thread>
+
 #include "base/message_loop/message_loop.h"
+#include "base/message_loop/task_timing_stats.h"
 #include "base/logging.h"
 
 namespace base {
@@ -16,50 +20,93 @@ namespace internal {
 
 namespace {
 
-std::chrono::milliseconds 
-CalculateDelayedRuntime(std::chrono::milliseconds delay) {
-	std::chrono::milliseconds delayed_run_time(0);
-	if (delay > std::chrono::milliseconds(0))
-		delayed_run_time = std::chrono::duration_cast<
-		std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch() +
-								   delay);
+TimeTicks CalculateDelayedRuntime(TimeDelta delay) {
+	TimeTicks delayed_run_time;
+	if (delay > TimeDelta())
+		delayed_run_time = TimeTicks::Now() + delay;
 	else
-		DCHECK_EQ(delay.count(), 0);
+		DCHECK(delay.is_zero());
 
 	return delayed_run_time;
 }
 
+// 一个有任务的队列连续这么多次没有被选中以后, 下一次一定选它. 高优先级的队列
+// 一直有任务的时候, 普通的队列至少能得到1/9的机会, 后台队列至少1/33.
+constexpr int kMaxSkippedSelections[kTaskQueuePriorityCount] = {
+	0,		// kHigh, 没有比它更高的队列.
+	8,		// kNormal.
+	32,		// kBestEffort.
+};
+
+// 任务不会再运行了, 让它的DelayedTaskHandle失效.
+void MarkDiscarded(const PendingTask& pending_task) {
+	if (pending_task.cancel_state)
+		pending_task.cancel_state->pending = false;
+}
+
 }	// namespace .
 
+constexpr TimeDelta IncomingTaskQueue::kHighResolutionDelayThreshold;
+
 IncomingTaskQueue::IncomingTaskQueue(MessageLoop * message_loop)
 	: always_schedule_work_(false),
 	  triage_tasks_(this),
 	  delayed_tasks_(this),
 	  deferred_tasks_(this),
-	  message_loop_(message_loop) {
+	  message_loop_(message_loop),
+	  post_state_(0),
+	  message_loop_scheduled_(false),
+	  is_ready_for_schedulig_(false) {
 }
 
-bool IncomingTaskQueue::AddToIncomingQueue(const Location & from_here,
-										   OnceClosure task,
-										   std::chrono::milliseconds delay,
-										   Nestable nestable) {
+bool IncomingTaskQueue::AddToIncomingQueue(
+	const Location & from_here,
+	OnceClosure task,
+	TimeDelta delay,
+	Nestable nestable,
+	TaskQueuePriority priority,
+	std::shared_ptr<CancelableTaskState> cancel_state) {
 	CHECK(!task.is_null());
 
 	PendingTask pending_task(from_here, std::move(task),
 							 CalculateDelayedRuntime(delay), nestable);
+	pending_task.priority = priority;
+	pending_task.is_high_res =
+		!delay.is_zero() && delay < kHighResolutionDelayThreshold;
+	pending_task.cancel_state = std::move(cancel_state);
 
 	return PostPendingTask(&pending_task);
 }
 
+bool IncomingTaskQueue::AddBatchToIncomingQueue(const Location& from_here,
+												std::vector<OnceClosure> tasks,
+												Nestable nestable,
+												TaskQueuePriority priority) {
+	if (tasks.empty())
+		return true;
+
+	std::vector<PendingTask> pending_tasks;
+	pending_tasks.reserve(tasks.size());
+	for (auto& task : tasks) {
+		CHECK(!task.is_null());
+		pending_tasks.emplace_back(from_here, std::move(task), TimeTicks(),
+								   nestable);
+		pending_tasks.back().priority = priority;
+	}
+
+	return PostPendingTasks(pending_tasks.data(), pending_tasks.size());
+}
+
 bool IncomingTaskQueue::IsIdleForTesting() {
-	std::lock_guard<std::mutex> lock(incoming_queue_lock_);
-	return incoming_queue_.empty();
+	return IncomingQueuesEmpty();
 }
 
 void IncomingTaskQueue::WillDestroyCurrentMessageLoop() {
-	{
-		std::lock_guard<std::mutex> lock(incoming_queue_lock_);
-		accept_new_tasks_ = false;
+	uint32_t state = post_state_.fetch_or(kShutdownBit, std::memory_order_acq_rel);
+	// 等正在提交任务的线程结束, 它们很快就会结束，并且不会拿着任何锁.
+	while ((state & ~kShutdownBit) != 0) {
+		std::this_thread::yield();
+		state = post_state_.load(std::memory_order_acquire);
 	}
 	{
 		std::lock_guard<std::mutex> lock(message_loop_lock_);
@@ -68,15 +115,14 @@ void IncomingTaskQueue::WillDestroyCurrentMessageLoop() {
 }
 
 void IncomingTaskQueue::StartScheduling() {
-	bool schedule_work;
-	{
-		std::lock_guard<std::mutex> lock(incoming_queue_lock_);
-		DCHECK(!is_ready_for_schedulig_);
-		DCHECK(!message_loop_scheduled_);
-		is_ready_for_schedulig_ = true;
-		schedule_work = !incoming_queue_.empty();
-	}
-	if (schedule_work) {
+	DCHECK(!is_ready_for_schedulig_.load(std::memory_order_relaxed));
+	DCHECK(!message_loop_scheduled_.load(std::memory_order_relaxed));
+	is_ready_for_schedulig_.store(true, std::memory_order_seq_cst);
+
+	// 在这之前提交的任务没有唤醒message loop, 之后提交的任务会看到
+	// |is_ready_for_schedulig_|, 所以这里只需要检查一次.
+	if (!IncomingQueuesEmpty() &&
+		!message_loop_scheduled_.exchange(true, std::memory_order_seq_cst)) {
 		DCHECK_NOTNULL(message_loop_);
 
 		// 这里不需要加锁，因为这个只会在自己的线程上调用.
@@ -84,35 +130,61 @@ void IncomingTaskQueue::StartScheduling() {
 	}
 }
 
+void IncomingTaskQueue::UseTimingWheelForDelayedTasks(TimeDelta tick) {
+	delayed_tasks_.UseTimingWheel(std::make_unique<TimingWheel>(tick));
+}
+
 void IncomingTaskQueue::RunTask(PendingTask * pending_task) {
+	// 任务开始运行以后就不能再取消了.
+	if (pending_task->cancel_state)
+		pending_task->cancel_state->pending = false;
+
 	// 运行任务.
 	std::move(pending_task->task).Run();
 }
 
+void IncomingTaskQueue::CancelDelayedTask(CancelableTaskState* cancel_state) {
+	DCHECK_EQ(this, cancel_state->queue);
+	delayed_tasks_.Cancel(cancel_state);
+}
+
 IncomingTaskQueue::~IncomingTaskQueue() {
 	// 用来验证WillDestroyCurrentMessageLoop()时调用了.
 	DCHECK(!message_loop_);
 }
 
 bool IncomingTaskQueue::PostPendingTask(PendingTask * pending_task) {
-	bool accept_new_tasks;
-	bool schedule_work = false;
+	return PostPendingTasks(pending_task, 1);
+}
 
-	{
-		std::lock_guard<std::mutex> lock(incoming_queue_lock_);
-		accept_new_tasks = accept_new_tasks_;
-		if (accept_new_tasks) {
-			schedule_work =
-				PostPendingTaskLockRequired(pending_task);
+bool IncomingTaskQueue::PostPendingTasks(PendingTask* pending_tasks,
+										 std::size_t count) {
+	// 先登记自己正在提交任务, 这样WillDestroyCurrentMessageLoop()不会在我们
+	// 提交到一半的时候返回.
+	const uint32_t state =
+		post_state_.fetch_add(kPosterIncrement, std::memory_order_acquire);
+	if (state & kShutdownBit) {
+		post_state_.fetch_sub(kPosterIncrement, std::memory_order_release);
+		for (std::size_t i = 0; i < count; ++i) {
+			MarkDiscarded(pending_tasks[i]);
+			pending_tasks[i].task.Reset();
 		}
+		return false;
 	}
 
-	if (!accept_new_tasks) {
-		DCHECK(!schedule_work);
-		pending_task->task.Reset();
-		return false;
+	// 同一批任务用同一个提交时间, 统计关闭的时候不读时钟.
+	if (TaskTimingStats::IsEnabled()) {
+		const TimeTicks now = TimeTicks::Now();
+		for (std::size_t i = 0; i < count; ++i)
+			pending_tasks[i].queue_time = now;
 	}
 
+	for (std::size_t i = 0; i < count; ++i)
+		EnqueuePendingTask(&pending_tasks[i]);
+	// 整批任务最多唤醒一次message loop.
+	const bool schedule_work = ShouldScheduleWorkAfterPost();
+	post_state_.fetch_sub(kPosterIncrement, std::memory_order_release);
+
 	// 唤醒message loop 并且给他派遣工作
 	if (schedule_work) {
 		// 锁住message loop, 防止message loop被释放.
@@ -124,48 +196,88 @@ bool IncomingTaskQueue::PostPendingTask(PendingTask * pending_task) {
 	return true;
 }
 
-bool IncomingTaskQueue::PostPendingTaskLockRequired(PendingTask * pending_task) {
-	//std::lock_guard<std::mutex> lock(incoming_queue_lock_);
-
-	pending_task->sequence_num = next_sequence_num_++;
-
-	bool was_empty = incoming_queue_.empty();
-	incoming_queue_.push(std::move(*pending_task));
+void IncomingTaskQueue::EnqueuePendingTask(PendingTask* pending_task) {
+	// message loop 线程自己提交的任务(任务里面再提交任务)最常见, 这时候可以复用
+	// incoming queue 缓存的节点.
+	MPSCQueue<PendingTask>& incoming_queue =
+		incoming_queues_[static_cast<int>(pending_task->priority)];
+	MessageLoop* current = MessageLoop::current();
+	if (current && current->incoming_task_queue_.get() == this)
+		incoming_queue.PushFromConsumer(std::move(*pending_task));
+	else
+		incoming_queue.Push(std::move(*pending_task));
+}
 
+bool IncomingTaskQueue::ShouldScheduleWorkAfterPost() {
 	// 当is_ready_for_schedulig_为true时，代表是已经调用了StartScheulig, 
-	// 如果always_schedule_work_为true，表示可以一直派遣工作，并且唤醒message loop
-	// 那样可以返回true，如果是第一个派遣工作也可以直接返回true.
-	if (is_ready_for_schedulig_ &&
-		(always_schedule_work_ || (!message_loop_scheduled_ && was_empty))) {
-		message_loop_scheduled_ = true;
+	// 如果always_schedule_work_为true，表示可以一直派遣工作，否则只有把
+	// |message_loop_scheduled_|从false改成true的那个线程需要唤醒message loop.
+	// 这里和ReloadWorkQueue()都用seq_cst: 如果我们看到的是true, 那么message loop
+	// 把它改成false以后一定能看到我们刚才加入的任务.
+	if (!is_ready_for_schedulig_.load(std::memory_order_seq_cst))
+		return false;
+	if (always_schedule_work_)
 		return true;
-	}
-
-	return false;
+	return !message_loop_scheduled_.exchange(true, std::memory_order_seq_cst);
 }
 
-
-int IncomingTaskQueue::ReloadWorkQueue(TaskQueue * work_queue) {
-	// work queue 必须为空
-	DCHECK(work_queue->empty());
-
-	// 加锁
-	std::lock_guard<std::mutex> lock(incoming_queue_lock_);
-	if (incoming_queue_.empty()) {
+PendingTask* IncomingTaskQueue::PeekIncomingTask() {
+	PendingTask* pending_task = SelectIncomingTask();
+	if (!pending_task) {
 		// 如果incoming queue为空的话，那么就代表这个incoming queue里面没有
-		// 任何的任务，这种情况意味着将需要sleep然后等待任务到来，如果这个
-		// incoming queue不是空的，那么就重新派遣任务, 这样就可以将
+		// 任何的任务，这种情况意味着将需要sleep然后等待任务到来, 将
 		// message_loop_scheduled_ 设置为false，让incoming queue不为空时，
 		// 可以派遣任务.
-		message_loop_scheduled_ = false;
+		message_loop_scheduled_.store(false, std::memory_order_seq_cst);
+		// 在设置为false之前加入任务的线程看到的还是true, 不会唤醒我们, 所以必须
+		// 再检查一次. 这里取到任务的话最多多一次没有必要的唤醒.
+		pending_task = SelectIncomingTask();
 	}
-	else {
-		incoming_queue_.swap(*work_queue);
+	return pending_task;
+}
+
+bool IncomingTaskQueue::IncomingQueuesEmpty() const {
+	for (const auto& incoming_queue : incoming_queues_) {
+		if (!incoming_queue.Empty())
+			return false;
+	}
+	return true;
+}
+
+PendingTask* IncomingTaskQueue::SelectIncomingTask() {
+	if (selected_queue_ >= 0)
+		return incoming_queues_[selected_queue_].Peek();
+
+	// 默认选优先级最高的有任务的队列, 但是被跳过太多次的队列优先.
+	int selected = -1;
+	for (int i = 0; i < kTaskQueuePriorityCount; ++i) {
+		if (!incoming_queues_[i].Peek())
+			continue;
+		if (selected < 0) {
+			selected = i;
+		}
+		else if (skipped_selections_[i] >= kMaxSkippedSelections[i]) {
+			selected = i;
+			break;
+		}
+	}
+	if (selected < 0)
+		return nullptr;
+
+	for (int i = 0; i < kTaskQueuePriorityCount; ++i) {
+		if (i == selected)
+			skipped_selections_[i] = 0;
+		else if (incoming_queues_[i].Peek())
+			++skipped_selections_[i];
 	}
+	selected_queue_ = selected;
+	return incoming_queues_[selected].Peek();
+}
 
-	int high_res_tasks = high_res_task_count_;
-	high_res_task_count_ = 0;
-	return high_res_tasks;
+void IncomingTaskQueue::PopIncomingTask() {
+	DCHECK_GE(selected_queue_, 0);
+	incoming_queues_[selected_queue_].Pop();
+	selected_queue_ = -1;
 }
 
 IncomingTaskQueue::TriageQueue::TriageQueue(IncomingTaskQueue * outer)
@@ -175,45 +287,36 @@ IncomingTaskQueue::TriageQueue::TriageQueue(IncomingTaskQueue * outer)
 IncomingTaskQueue::TriageQueue::~TriageQueue() = default;
 
 const PendingTask & IncomingTaskQueue::TriageQueue::Peek() {
-	ReloadFromIncomingQueueIfEmpty();
-	DCHECK(!queue_.empty());
-	return queue_.front();
+	PendingTask* pending_task = outer_->PeekIncomingTask();
+	DCHECK(pending_task);
+	return *pending_task;
 }
 
 PendingTask IncomingTaskQueue::TriageQueue::Pop() {
-	ReloadFromIncomingQueueIfEmpty();
-	DCHECK(!queue_.empty());
-	PendingTask pending_task = std::move(queue_.front());
-	queue_.pop();
+	PendingTask* front = outer_->PeekIncomingTask();
+	DCHECK(front);
+	PendingTask pending_task = std::move(*front);
+	outer_->PopIncomingTask();
 
-	if (pending_task.is_high_res)
-		--outer_->pending_high_res_tasks_;
-	
+	pending_task.sequence_num = outer_->next_sequence_num_++;
 	return pending_task;
 }
 
 bool IncomingTaskQueue::TriageQueue::HasTasks() {
-	ReloadFromIncomingQueueIfEmpty();
-	return !queue_.empty();
+	return outer_->PeekIncomingTask() != nullptr;
 }
 
 void IncomingTaskQueue::TriageQueue::Clear() {
-	while (!queue_.empty()) {
-		PendingTask pending_task = std::move(queue_.front());
-		queue_.pop();
+	// 只删除现在能看到的任务, 不修改|message_loop_scheduled_|.
+	while (outer_->SelectIncomingTask()) {
+		PendingTask pending_task = Pop();
 
-		if (pending_task.is_high_res)
-			--outer_->pending_high_res_tasks_;
-
-		if (pending_task.delayed_run_time.count()) {
+		if (!pending_task.delayed_run_time.is_null()) {
 			outer_->delayed_tasks().Push(std::move(pending_task));
 		}
-	}
-}
-
-void IncomingTaskQueue::TriageQueue::ReloadFromIncomingQueueIfEmpty() {
-	if (queue_.empty()) {
-		outer_->pending_high_res_tasks_ += outer_->ReloadWorkQueue(&queue_);
+		else {
+			MarkDiscarded(pending_task);
+		}
 	}
 }
 
@@ -225,38 +328,96 @@ IncomingTaskQueue::DelayedQueue::DelayedQueue(IncomingTaskQueue * outer)
 IncomingTaskQueue::DelayedQueue::~DelayedQueue() = default;
 
 const PendingTask & IncomingTaskQueue::DelayedQueue::Peek() {
-	DCHECK(!queue_.empty());
-	return queue_.top();
+	if (wheel_)
+		return wheel_->Peek();
+
+	return queue_.Peek();
 }
 
 PendingTask IncomingTaskQueue::DelayedQueue::Pop() {
-	DCHECK(!queue_.empty());
-	PendingTask delayed_task = std::move(const_cast<PendingTask&>(queue_.top()));
-	queue_.pop();
+	PendingTask delayed_task = wheel_ ? wheel_->Pop() : queue_.Pop();
 
+	if (delayed_task.cancel_state) {
+		delayed_task.cancel_state->queue = nullptr;
+		delayed_task.cancel_state->wheel_node = nullptr;
+	}
 	if (delayed_task.is_high_res)
 		--outer_->pending_high_res_tasks_;
 	return delayed_task;
 }
 
 bool IncomingTaskQueue::DelayedQueue::HasTasks() {
-	//return !queue_.empty();
-	while (!queue_.empty() && Peek().task.is_null())
+	while (!Empty() && Peek().task.is_null())
 		Pop();
 	
-	return !queue_.empty();
+	return !Empty();
 }
 
 void IncomingTaskQueue::DelayedQueue::Clear() {
-	while (!queue_.empty())
-		Pop();
+	while (!Empty())
+		MarkDiscarded(Pop());
 }
 
 void IncomingTaskQueue::DelayedQueue::Push(PendingTask pending_task) {
 	if (pending_task.is_high_res)
 		++outer_->pending_high_res_tasks_;
 
-	queue_.push(std::move(pending_task));
+	Insert(std::move(pending_task));
+}
+
+void IncomingTaskQueue::DelayedQueue::UseTimingWheel(
+	std::unique_ptr<TimingWheel> wheel) {
+	DCHECK(wheel.get());
+	std::unique_ptr<TimingWheel> old_wheel = std::move(wheel_);
+	wheel_ = std::move(wheel);
+
+	// 直接在两个容器之间移动, 不经过Pop()/Push(), 高分辨率任务的计数不变.
+	while (!queue_.empty())
+		Insert(queue_.Pop());
+	if (old_wheel) {
+		while (!old_wheel->empty())
+			Insert(old_wheel->Pop());
+	}
+}
+
+void IncomingTaskQueue::DelayedQueue::Cancel(CancelableTaskState* cancel_state) {
+	DCHECK_EQ(outer_, cancel_state->queue);
+
+	bool is_high_res;
+	if (wheel_) {
+		DCHECK(cancel_state->wheel_node);
+		is_high_res = TimingWheel::GetTask(cancel_state->wheel_node).is_high_res;
+		wheel_->Cancel(cancel_state->wheel_node);
+	}
+	else {
+		// 任务在这里被析构, 它持有的资源马上就会释放.
+		is_high_res = queue_.Erase(cancel_state->heap_index).is_high_res;
+	}
+
+	cancel_state->queue = nullptr;
+	cancel_state->wheel_node = nullptr;
+	if (is_high_res)
+		--outer_->pending_high_res_tasks_;
+}
+
+bool IncomingTaskQueue::DelayedQueue::Empty() const {
+	return wheel_ ? wheel_->empty() : queue_.empty();
+}
+
+void IncomingTaskQueue::DelayedQueue::Insert(PendingTask pending_task) {
+	CancelableTaskState* cancel_state = pending_task.cancel_state.get();
+	if (cancel_state)
+		cancel_state->queue = outer_;
+
+	if (wheel_) {
+		TimingWheel::Handle handle = wheel_->Push(std::move(pending_task));
+		if (cancel_state)
+			cancel_state->wheel_node = handle;
+	}
+	else {
+		// |heap_index|由|queue_|负责更新.
+		queue_.Push(std::move(pending_task));
+	}
 }
 
 IncomingTaskQueue::DeferredQueue::DeferredQueue(IncomingTaskQueue * outer)
@@ -287,7 +448,7 @@ bool IncomingTaskQueue::DeferredQueue::HasTasks() {
 
 void IncomingTaskQueue::DeferredQueue::Clear() {
 	while (!queue_.empty())
-		Pop();
+		MarkDiscarded(Pop());
 }
 
 void IncomingTaskQueue::DeferredQueue::Push(PendingTask pending_task) {
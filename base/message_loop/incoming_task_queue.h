@@ -8,14 +8,21 @@
 #ifndef BASE_MESSAGE_LOOP_INCOMING_TASK_QUEUE_H
 #define BASE_MESSAGE_LOOP_INCOMING_TASK_QUEUE_H
 
-#include <chrono>
+#include <stdint.h>
+
+#include <atomic>
 #include <mutex>
 #include <memory>
+#include <vector>
 
 #include "base/base_export.h"
 #include "base/callback.h"
 #include "base/macor.h"
+#include "base/message_loop/delayed_task_heap.h"
+#include "base/message_loop/timing_wheel.h"
+#include "base/mpsc_queue.h"
 #include "base/pending_task.h"
+#include "base/time/time.h"
 
 namespace base {
 
@@ -27,6 +34,17 @@ namespace internal {
 // Implements a queue of tasks posted to the message loop running on the current
 // thread. This class takes care of synchronizing posting tasks from different
 // threads and together with MessageLoop ensures clean sutdown.
+//
+// 提交任务的线程之间以及和message loop线程之间没有锁: 任务放进一个无锁的MPSC
+// 队列, message loop 线程通过triage_tasks()直接从这个队列的队头取任务, 任务
+// 不会先被复制到另外一个队列. message loop 线程自己提交的任务复用队列缓存的
+// 节点, 不需要分配内存.
+//
+// 每一个TaskQueuePriority都有自己的MPSC队列. triage_tasks()总是先取优先级高的
+// 队列, 但是一个有任务的队列连续被跳过太多次以后一定会被选中一次(见
+// incoming_task_queue.cc里面的kMaxSkippedSelections), 所以高优先级的任务再多也不会饿死低优先级的任务.
+// 选择只需要看每个队列的队头, 是O(1)的. 同一个队列里面的任务保持先进先出,
+// 不同队列之间没有顺序保证.
 class IncomingTaskQueue {
  public:
 	 // 提供一个用于读和删除的队列虚基类.
@@ -69,12 +87,25 @@ class IncomingTaskQueue {
 	 // 添加一个任务到incoming queue. 所有的任务都需要通过AddToIncomingQueue() or
 	 // TryAddToIncomingQueue()，多个不同的线程可以同时提交.
 	 // 如果成功返回true, 否则放回false，任务的所有权会被转移到调用的方法.
-	 bool AddToIncomingQueue(const Location& from_here,
-							 OnceClosure task,
-							 std::chrono::milliseconds delay,
-							 Nestable nestable);
-
-	 // Returns true if the message loop is "idle".
+	 // 延迟小于kHighResolutionDelayThreshold的任务会被标记为is_high_res.
+	 // |cancel_state|不为null的时候, 任务可以通过CancelDelayedTask()取消.
+	 bool AddToIncomingQueue(
+		 const Location& from_here,
+		 OnceClosure task,
+		 TimeDelta delay,
+		 Nestable nestable,
+		 TaskQueuePriority priority = TaskQueuePriority::kNormal,
+		 std::shared_ptr<CancelableTaskState> cancel_state = nullptr);
+
+	 // 一次加入一批没有延迟的任务, 最多唤醒一次message loop.
+	 // 所有的任务都加入成功返回true.
+	 bool AddBatchToIncomingQueue(
+		 const Location& from_here,
+		 std::vector<OnceClosure> tasks,
+		 Nestable nestable,
+		 TaskQueuePriority priority = TaskQueuePriority::kNormal);
+
+	 // Returns true if the message loop is "idle". 只能在message loop 线程调用.
 	 bool IsIdleForTesting();
 
 	 // 将this从父消息循环断开.
@@ -86,16 +117,29 @@ class IncomingTaskQueue {
 	 // Runs |pending_task|.
 	 void RunTask(PendingTask* pending_task);
 
+	 // 把|cancel_state|对应的任务从延迟队列里面删除, 任务持有的资源会被马上释放.
+	 // 任务必须在延迟队列里面(|cancel_state->queue|等于this), 只能在message loop
+	 // 线程调用.
+	 void CancelDelayedTask(CancelableTaskState* cancel_state);
+
 	 ReadAndRemoveOnlyQueue& triage_tasks() { return triage_tasks_; }
 
 	 Queue& delayed_tasks() { return delayed_tasks_; }
 
 	 Queue& deferred_tasks() { return deferred_tasks_; }
 
+	 // 把延迟任务的存储从二叉堆换成精度为|tick|的分层时间轮, 已经有的延迟任务
+	 // 会被移过去. 只能在message loop 线程调用.
+	 void UseTimingWheelForDelayedTasks(TimeDelta tick);
+
 	 bool HasPendingHighResolutionTasks() {
 		 return pending_high_res_tasks_ > 0;
 	 }
 
+	 // 比这个更短的延迟需要高分辨率的计时器才能准时运行.
+	 static constexpr TimeDelta kHighResolutionDelayThreshold =
+		 TimeDelta::FromMilliseconds(32);
+
 
  private:
 	 friend struct DefaultDestroyTraits;
@@ -108,7 +152,8 @@ class IncomingTaskQueue {
 		  ~TriageQueue() OVERRIDE;
 
 		  // ReadAndRemoveOnlyQueue:
-		  // 如果队列时空的(调用clear除外), 那么下列方法就会从incoming 队列从新加载.
+		  // 直接读取incoming queue 的队头. 任务的sequence_num在Pop()的时候分配,
+		  // 所以Peek()返回的任务还没有sequence_num.
 		  const PendingTask& Peek() OVERRIDE;
 		  PendingTask Pop() OVERRIDE;
 
@@ -116,11 +161,7 @@ class IncomingTaskQueue {
 		  void Clear() OVERRIDE;
 
 	  private:
-		  // 如果队列为空从incoming queue 重新加载.
-		  void ReloadFromIncomingQueueIfEmpty();
-
 		  IncomingTaskQueue* const outer_;
-		  TaskQueue queue_;
 
 		  DISALLOW_COPY_AND_ASSIGN(TriageQueue);
 	 };
@@ -138,9 +179,24 @@ class IncomingTaskQueue {
 		  void Clear() OVERRIDE;
 		  void Push(PendingTask pending_task) OVERRIDE;
 
+		  // 之后的任务都保存在|wheel|里面.
+		  void UseTimingWheel(std::unique_ptr<TimingWheel> wheel);
+
+		  // 删除|cancel_state|对应的任务, 它必须在这个队列里面.
+		  void Cancel(CancelableTaskState* cancel_state);
+
 	  private:
+		  bool Empty() const;
+
+		  // 把任务放进|wheel_|或者|queue_|, 并且在它的cancel_state里面记下位置.
+		  // 不修改高分辨率任务的计数.
+		  void Insert(PendingTask pending_task);
+
 		  IncomingTaskQueue* const outer_;
-		  DelayedTaskQueue queue_;
+		  DelayedTaskHeap queue_;
+
+		  // 不为空的时候代替|queue_|保存所有的延迟任务.
+		  std::unique_ptr<TimingWheel> wheel_;
 
 		  DISALLOW_COPY_AND_ASSIGN(DelayedQueue);
 	 };
@@ -173,13 +229,29 @@ class IncomingTaskQueue {
 	 // pending_task->task的生命周期不会超过这个函数.
 	 bool PostPendingTask(PendingTask* pending_task);
 
-	 // 这个函数作真正的posting a pending task, 如果返回true，这个调用一你应该在
-	 // 这个message loop 上面调用ScheduleWork() .
-	 bool PostPendingTaskLockRequired(PendingTask* pending_task);
+	 // 和PostPendingTask()一样, 但是一次加入|count|个任务.
+	 bool PostPendingTasks(PendingTask* pending_tasks, std::size_t count);
+
+	 // 把|pending_task|放进incoming queue, 必须已经在|post_state_|里面登记过.
+	 void EnqueuePendingTask(PendingTask* pending_task);
+
+	 // 加入任务以后调用, 如果返回true，调用者应该在这个message loop 上面调用
+	 // ScheduleWork().
+	 bool ShouldScheduleWorkAfterPost();
+
+	 // 返回incoming queue 队头的任务. 看不到任务的时候清除|message_loop_scheduled_|
+	 // 再看一次, 还是没有就返回nullptr. 只能在message loop 线程调用.
+	 PendingTask* PeekIncomingTask();
+
+	 // 所有的incoming queue 都看不到任务的时候返回true. 只能在message loop 线程调用.
+	 bool IncomingQueuesEmpty() const;
 
-	 // 加载任务，从incoming queue到work queue
-	 // 返回|work_queue|中需要高分辨率计时器的任务数量。
-	 int ReloadWorkQueue(TaskQueue* work_queue);
+	 // 选出下一个任务所在的队列, 直到它被PopIncomingTask()取走之前都不会变.
+	 // 所有的队列都看不到任务的时候返回nullptr.
+	 PendingTask* SelectIncomingTask();
+
+	 // 删除PeekIncomingTask()返回的任务.
+	 void PopIncomingTask();
 
 	 // 如果设置为true，表示只要接受到任务就会调用ScheduleWork(), 
 	 // 只要incoming queue 不是空.
@@ -200,35 +272,34 @@ class IncomingTaskQueue {
 	 // 指向拥有this的消息循环.
 	 MessageLoop* message_loop_;
 
-	 // 用于同步访问该行一下的所有数据.
-	 std::mutex incoming_queue_lock_;
-
-	 // Number of tasks that require high resolution timing.This value is kept
-	 // so that ReloadWorkQueue() completes in constant time.
-	 int high_res_task_count_ = 0;
-
-	 // 这个队列里面保存的任务是还没有放到message loop 中的.
-	 TaskQueue incoming_queue_;
-
-	 // 如果应该接受新的任务就为true.
-	 bool accept_new_tasks_ = true;
-
-	 // 用于延迟任务的下一个序列号.
+	 // |post_state_|的最高位表示不再接受新的任务, 其余的位是正在提交任务的线程
+	 // 数量. WillDestroyCurrentMessageLoop()设置最高位以后会等所有正在提交的线程
+	 // 结束, 这样它返回以后就不会再有任务加入incoming queue.
+	 static constexpr uint32_t kShutdownBit = 1u << 31;
+	 static constexpr uint32_t kPosterIncrement = 1;
+	 std::atomic<uint32_t> post_state_;
+
+	 // 这些队列里面保存的任务是还没有放到message loop 中的, 下标是
+	 // TaskQueuePriority.
+	 MPSCQueue<PendingTask> incoming_queues_[kTaskQueuePriorityCount];
+
+	 // 下面的成员只在message loop 线程访问.
+	 // SelectIncomingTask()选中的队列, -1表示还没有选.
+	 int selected_queue_ = -1;
+	 // 每个队列有任务但是没有被选中的连续次数.
+	 int skipped_selections_[kTaskQueuePriorityCount] = {};
+
+	 // 用于延迟任务的下一个序列号. 在message loop 线程从triage_tasks()取出任务的
+	 // 时候分配, 和incoming queue 的顺序一致.
 	 int next_sequence_num_ = 0;
 
 	 // 如果我们的message loop 是已经scheduled并且不需要再一次scheduled时为true.
-	 // 直到为空时在重新加载.
-	 bool message_loop_scheduled_ = false;
+	 // 直到为空时在重新加载. 提交任务的线程通过exchange抢着把它设置为true, 只有
+	 // 抢到的那个线程才会唤醒message loop.
+	 std::atomic_bool message_loop_scheduled_;
 
 	 // 直到StartScheduling()调用前都为false.
-	 bool is_ready_for_schedulig_ = false;
-
-	 // True if the outgoing queue (|triage_tasks_|) is empty. Toggled under
-	 // |incoming_queue_lock_| in ReloadWorkQueue() so that
-	 // PostPendingTaskLockRequired() can tell, without accessing the thread unsafe
-	 // |triage_tasks_|, if the IncomingTaskQueue has been made non-empty by a
-	 // PostTask() (and needs to inform its Observer).
-	 bool triage_queue_empty_ = true;
+	 std::atomic_bool is_ready_for_schedulig_;
 
 	 DISALLOW_COPY_AND_ASSIGN(IncomingTaskQueue);
 };
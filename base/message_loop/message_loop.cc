@@ -7,6 +7,7 @@
 */
 #include "base/message_loop/message_loop.h"
 
+#include <algorithm>
 #include <utility>
 #include <thread>
 
@@ -33,6 +34,9 @@ std::unique_ptr<MessagePump> ReturnPump(MessagePump* pump) {
 
 }	// namespace .
 
+constexpr TimeDelta MessageLoop::kMaxIdlePeriod;
+constexpr TimeDelta MessageLoop::kMinIdlePeriod;
+
 MessageLoop::MessageLoop(Type type)
 	: MessageLoop(type, MessagePumpFactoryCallback()) {
 	BindToCurrentThread();
@@ -83,6 +87,8 @@ MessageLoop::~MessageLoop() {
 	incoming_task_queue_->WillDestroyCurrentMessageLoop();
 	incoming_task_queue_ = nullptr;
 	unbound_task_runner_ = nullptr;
+	for (auto& priority_task_runner : priority_task_runners_)
+		priority_task_runner = nullptr;
 	task_runner_ = nullptr;
 
 	// OK, 现在我们将current()也设置为nullptr,现在就没有人可以访问到我们了
@@ -106,7 +112,9 @@ MessageLoop::CreateMessagePumpForType(Type type) {
 	}
 
 	if (type == MessageLoop::TYPE_IO) {
-
+#if defined(OS_LINUX)
+		return std::make_unique<MessagePumpEpoll>();
+#endif
 	}
 
 	DCHECK_EQ(type, MessageLoop::TYPE_DEFAULT);
@@ -144,10 +152,20 @@ void MessageLoop::SetTaskRunner(const std::shared_ptr<SingleThreadTaskRunner>& t
 	task_runner_ = task_runner;
 }
 
+std::shared_ptr<SingleThreadTaskRunner>
+MessageLoop::task_runner(TaskQueuePriority priority) const {
+	return priority_task_runners_[static_cast<int>(priority)];
+}
+
 void MessageLoop::ClearTaskRunnerForTesting()
 {
 }
 
+void MessageLoop::UseTimingWheelForDelayedTasks(TimeDelta tick) {
+	DCHECK_EQ(this, current());
+	incoming_task_queue_->UseTimingWheelForDelayedTasks(tick);
+}
+
 void MessageLoop::SetNestableTasksAllowed(bool allowed) {
 	if (allowed) {
 		//CHECK(RunLoop::IsNestingAllowedOnCurrentThread());
@@ -160,6 +178,7 @@ void MessageLoop::SetNestableTasksAllowed(bool allowed) {
 }
 
 void MessageLoop::Run(bool application_tasks_allowed) {
+	idle_period_allowed_ = true;
 	if (application_tasks_allowed && !task_execution_allowed_) {
 		task_execution_allowed_ = true;
 		pump_->Run(this);
@@ -183,6 +202,14 @@ bool MessageLoop::NestableTasksAllowed() const {
 	return task_execution_allowed_;
 }
 
+void MessageLoop::PostIdleTask(const Location& from_here, IdleTask task) {
+	DCHECK_EQ(this, current());
+	DCHECK(static_cast<bool>(task));
+	next_idle_tasks_.push(PendingIdleTask{from_here, std::move(task)});
+	// 消息循环可能已经没有事情做在睡眠了.
+	pump_->ScheduleWork();
+}
+
 void MessageLoop::AddTaskObserver(
 	std::shared_ptr<TaskObserver> task_observer) {
 	DCHECK_EQ(this, current());
@@ -215,6 +242,14 @@ MessageLoop::MessageLoop(Type type,
 	  task_runner_(unbound_task_runner_){
 	// 如果类型是TYPE_CUSTOM 那么pump_factory 必须不为空.
 	DCHECK(type_ != TYPE_CUSTOM || !pump_factory_);
+
+	for (int i = 0; i < kTaskQueuePriorityCount; ++i) {
+		const auto priority = static_cast<TaskQueuePriority>(i);
+		priority_task_runners_[i] = priority == TaskQueuePriority::kNormal
+			? unbound_task_runner_
+			: WrapShared(new internal::MessageLoopTaskRunner(incoming_task_queue_,
+															 priority));
+	}
 }
 
 void MessageLoop::BindToCurrentThread() {
@@ -233,7 +268,9 @@ void MessageLoop::BindToCurrentThread() {
 	auto tls_mes_lop = *GetTLSMessageLoop();
 
 	incoming_task_queue_->StartScheduling();
-	unbound_task_runner_->BindToCurrentThread();
+	// |unbound_task_runner_|也在里面.
+	for (auto& priority_task_runner : priority_task_runners_)
+		priority_task_runner->BindToCurrentThread();
 	unbound_task_runner_ = nullptr;
 	SetThreadTaskRunnerHandle();
 	thread_id_ = PlatformThread::CurrentId();
@@ -266,7 +303,14 @@ void MessageLoop::RunTask(PendingTask * pending_task) {
 
 	for (auto& observer : task_observers_)
 		observer->OnBeforeProcessTask(*pending_task);
+	// 提交的时候打开了统计才会有|queue_time|.
+	const TimeTicks start_time = pending_task->queue_time.is_null()
+		? TimeTicks() : TimeTicks::Now();
 	incoming_task_queue_->RunTask(pending_task);
+	if (!start_time.is_null()) {
+		task_timing_stats_.RecordTask(*pending_task, start_time,
+									  TimeTicks::Now());
+	}
 	for (auto& observer : task_observers_)
 		observer->OnAfterProcessTask(*pending_task);
 
@@ -274,10 +318,15 @@ void MessageLoop::RunTask(PendingTask * pending_task) {
 	task_execution_allowed_ = true;
 
 	current_pending_task_ = nullptr;
+	idle_period_allowed_ = true;
 }
 
 
 bool MessageLoop::DeferOrRunPendingTask(PendingTask pending_task) {
+	// 被推迟以后才取消的任务.
+	if (pending_task.is_cancelled())
+		return false;
+
 	// 添加到闲置任务，或者直接运行任务.
 	if (pending_task.nestable == Nestable::kNestable ||
 		!RunLoop::IsNestedOnCurrentThread()) {
@@ -294,6 +343,8 @@ bool MessageLoop::DeferOrRunPendingTask(PendingTask pending_task) {
 }
 
 void MessageLoop::DeletePendingTasks() {
+	idle_tasks_ = std::queue<PendingIdleTask>();
+	next_idle_tasks_ = std::queue<PendingIdleTask>();
 	incoming_task_queue_->triage_tasks().Clear();
 	incoming_task_queue_->deferred_tasks().Clear();
 	incoming_task_queue_->delayed_tasks().Clear();
@@ -310,10 +361,11 @@ bool MessageLoop::DoWork() {
 	// Execute oldest task.
 	while (incoming_task_queue_->triage_tasks().HasTasks()) {
 		PendingTask pending_task = incoming_task_queue_->triage_tasks().Pop();
-		if (!pending_task.task)
+		// 还在incoming queue里面的时候就被取消了的任务, 在这里丢掉.
+		if (!pending_task.task || pending_task.is_cancelled())
 			continue;
 
-		if (pending_task.delayed_run_time.count() != 0) {
+		if (!pending_task.delayed_run_time.is_null()) {
 			// 延迟时间不为0，是一个延迟任务，将他加入到延迟队列.
 			int sequence_num = pending_task.sequence_num;
 			auto delayed_run_time = pending_task.delayed_run_time;
@@ -335,14 +387,12 @@ bool MessageLoop::DoWork() {
 	return false;
 }
 
-bool MessageLoop::DoDelayedWork(
-	std::chrono::milliseconds& next_delayed_work_time) {
+bool MessageLoop::DoDelayedWork(TimeTicks& next_delayed_work_time) {
 	if (!task_execution_allowed_ ||
 		!incoming_task_queue_->delayed_tasks().HasTasks()) {
 		// 没有任务，或者是不允许执行任务时，我们更新最新的时间.
-		recent_time_ = next_delayed_work_time =
-			std::chrono::milliseconds(0);
-				
+		recent_time_ = next_delayed_work_time = TimeTicks();
+
 		return false;
 	}
 
@@ -354,8 +404,7 @@ bool MessageLoop::DoDelayedWork(
 		incoming_task_queue_->delayed_tasks().Peek().delayed_run_time;
 	if (next_run_time > recent_time_) {
 		// 如果延迟时间大于我们最新的时间,我们重新获取最新的时间，并且重新比较.
-		recent_time_ = std::chrono::duration_cast<std::chrono::milliseconds>(
-			std::chrono::system_clock::now().time_since_epoch());
+		recent_time_ = TimeTicks::Now();
 		if (next_run_time > recent_time_) {
 			// 还是大于需要延迟的时间，返回并且等待到达延迟时间再执行.
 			next_delayed_work_time = next_run_time;
@@ -378,7 +427,12 @@ bool MessageLoop::DoIdleWork() {
 	if (ProcessNextDelayedNoNestableTask())
 		return true;
 
-	
+	if (RunNextIdleTask())
+		return true;
+
+	// pump在DoIdleWork()之后就会睡眠, 在这之前决定这一次睡眠需要的精度.
+	UpdateTimerSlack();
+
 	if (ShouldQuitWhenIdle())
 		pump_->Quit();
 		
@@ -386,11 +440,59 @@ bool MessageLoop::DoIdleWork() {
 	return false;
 }
 
-MessageLoop::DestructionObserver::~DestructionObserver()
-{
+bool MessageLoop::RunNextIdleTask() {
+	if (!task_execution_allowed_)
+		return false;
+
+	if (idle_tasks_.empty()) {
+		// 要退出的时候, 上一次空闲时间以后没有运行过别的任务就不再开始新的空闲
+		// 时间, 否则一直重新提交自己的空闲任务会让RunUntilIdle()无法返回.
+		if (next_idle_tasks_.empty() ||
+			(ShouldQuitWhenIdle() && !idle_period_allowed_))
+			return false;
+		idle_tasks_.swap(next_idle_tasks_);
+		idle_period_allowed_ = false;
+	}
+
+	const TimeTicks now = TimeTicks::Now();
+	TimeTicks deadline = now + kMaxIdlePeriod;
+	if (incoming_task_queue_->delayed_tasks().HasTasks()) {
+		deadline = std::min(
+			deadline, incoming_task_queue_->delayed_tasks().Peek().delayed_run_time);
+	}
+	// 下一个延迟任务马上就要运行了, 等它运行完再说.
+	if (deadline - now < kMinIdlePeriod)
+		return false;
+
+	PendingIdleTask idle_task = std::move(idle_tasks_.front());
+	idle_tasks_.pop();
+
+	// 和RunTask()一样, 空闲任务里面不能直接运行别的任务.
+	task_execution_allowed_ = false;
+	idle_task.task(deadline);
+	task_execution_allowed_ = true;
+
+	++idle_task_stats_.tasks_run;
+	const TimeDelta overrun = TimeTicks::Now() - deadline;
+	if (overrun > TimeDelta()) {
+		++idle_task_stats_.overruns;
+		idle_task_stats_.total_overrun += overrun;
+		if (overrun > idle_task_stats_.max_overrun) {
+			idle_task_stats_.max_overrun = overrun;
+			idle_task_stats_.max_overrun_posted_from = idle_task.posted_from;
+		}
+	}
+	return true;
 }
 
-MessageLoop::TaskObserver::TaskObserver()
+void MessageLoop::UpdateTimerSlack() {
+	pump_->SetTimerSlack(
+		incoming_task_queue_->HasPendingHighResolutionTasks()
+			? MessagePump::TIMER_SLACK_NONE
+			: MessagePump::TIMER_SLACK_MAXIMUM);
+}
+
+MessageLoop::DestructionObserver::~DestructionObserver()
 {
 }
 
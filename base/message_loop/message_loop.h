@@ -8,25 +8,32 @@
 #ifndef BASE_MESSAGE_LOOP_MESSAGE_LOOP_H
 #define BASE_MESSAGE_LOOP_MESSAGE_LOOP_H
 
+#include <stdint.h>
+
 #include <memory>
 #include <queue>
 #include <string>
-#include <chrono>
 #include <list>
 
 #include "base/base_export.h"
 #include "base/callback.h"
+#include "base/logging.h"
 #include "base/macor.h"
 //#include "base/threading/thread.h"
 #include "base/message_loop/incoming_task_queue.h"
 #include "base/message_loop/message_pump.h"
 #include "base/message_loop/message_pump_default.h"
+#include "base/message_loop/task_timing_stats.h"
+#if defined(OS_LINUX)
+#include "base/message_loop/message_pump_epoll.h"
+#endif
 #include "base/pending_task.h"
 #include "base/threading/platform_thread.h"
 #include "base/single_thread_task_runner.h"
 #include "base/threading/thread_task_runner_handle.h"
 #include "base/message_loop/message_loop_task_runner.h"
 #include "base/run_loop.h"
+#include "base/time/time.h"
 
 
 
@@ -126,6 +133,14 @@ class BASE_EXPORT MessageLoop : public MessagePump::Delegate,
 		 return task_runner_;
 	 }
 
+	 // 返回这个消息循环上优先级为|priority|的任务队列的TaskRunner, kNormal的队列
+	 // 就是task_runner()最开始的那个. DoWork()优先运行高优先级队列的任务, 但是
+	 // 低优先级的队列不会饿死, 见IncomingTaskQueue. 同一个队列的任务按照提交的
+	 // 顺序运行, 不同队列之间没有顺序保证. 延迟任务到期以后按照运行时间的顺序
+	 // 运行, 和优先级无关.
+	 std::shared_ptr<SingleThreadTaskRunner> task_runner(
+		 TaskQueuePriority priority) const;
+
 
 	 // Sets a new TaskRunner for this message loop. The message loop must already
 	 // have been bound to a thred prior to this call, and the task runner must
@@ -138,6 +153,12 @@ class BASE_EXPORT MessageLoop : public MessagePump::Delegate,
 	 // Must be called on the thread to which the message loop is bound.
 	 void ClearTaskRunnerForTesting();
 
+	 // 延迟任务默认保存在二叉堆里面, 插入是O(log n)的. 一个线程上有大量(比如几十
+	 // 万个)延迟任务的时候可以换成分层时间轮, 插入是O(1)的. |tick|是时间轮每一格的
+	 // 长度, 不影响任务运行的精度. 只能在这个消息循环的线程上调用.
+	 void UseTimingWheelForDelayedTasks(
+		 TimeDelta tick = TimeDelta::FromMilliseconds(1));
+
 	 void SetNestableTasksAllowed(bool allowed);
 	 bool NestableTasksAllowed() const;
 
@@ -157,7 +178,10 @@ class BASE_EXPORT MessageLoop : public MessagePump::Delegate,
 
 	 class BASE_EXPORT TaskObserver {
 	  public:
-		  TaskObserver();
+		  // 在使用者的代码里面展开, 观察者读到的PendingTask必须和base里面的布局一样.
+		  TaskObserver() {
+			  CHECK(sizeof(PendingTask) == internal::PendingTaskSizeInBase());
+		  }
 
 		  virtual void OnBeforeProcessTask(const PendingTask& pending_task) = 0;
 
@@ -167,6 +191,46 @@ class BASE_EXPORT MessageLoop : public MessagePump::Delegate,
 		  virtual ~TaskObserver() = default;
 	 };
 
+	 // 空闲任务的参数是它应该结束的时间. 做不完的工作可以再PostIdleTask()一次,
+	 // 留到下一次空闲的时候.
+	 using IdleTask = Callback<void(TimeTicks deadline)>;
+
+	 // 提交一个只在这个消息循环空闲的时候运行的任务, 例如清理缓存和写统计数据,
+	 // 这样它们不会推迟前台的任务. 每次没有别的工作的时候运行一个空闲任务, 截止
+	 // 时间是现在加上kMaxIdlePeriod和下一个延迟任务的运行时间里面早的那一个,
+	 // 离下一个延迟任务不到kMinIdlePeriod的时候不运行空闲任务. 运行完一个空闲任务
+	 // 以后会先处理新的任务和到期的延迟任务.
+	 //
+	 // 在空闲任务里面提交的空闲任务要等到下一次空闲才会运行, RunUntilIdle()
+	 // 只会运行一次空闲时间, 不会被一直重新提交自己的空闲任务卡住. 只能在这个
+	 // 消息循环的线程上调用.
+	 void PostIdleTask(const Location& from_here, IdleTask task);
+
+	 // 一次空闲时间最长是多少.
+	 static constexpr TimeDelta kMaxIdlePeriod = TimeDelta::FromMilliseconds(50);
+	 // 空闲时间比这个还短的时候不运行空闲任务.
+	 static constexpr TimeDelta kMinIdlePeriod = TimeDelta::FromMilliseconds(1);
+
+	 // 空闲任务的统计, 用来发现超过截止时间的空闲任务.
+	 struct IdleTaskStats {
+		 // 运行了的空闲任务的数量.
+		 uint64_t tasks_run = 0;
+		 // 超过截止时间才结束的空闲任务的数量.
+		 uint64_t overruns = 0;
+		 // 所有的空闲任务超过截止时间的总和.
+		 TimeDelta total_overrun;
+		 // 超过截止时间最多的一次, 和提交它的位置.
+		 TimeDelta max_overrun;
+		 Location max_overrun_posted_from;
+	 };
+
+	 const IdleTaskStats& idle_task_stats() const { return idle_task_stats_; }
+
+	 // 这个线程上的任务的排队时间和运行时间, 需要先调用
+	 // TaskTimingStats::SetEnabled(true). 只能在这个消息循环的线程上调用, 其他线程
+	 // 想要查看的话可以提交一个任务过来调用Dump().
+	 TaskTimingStats& task_timing_stats() { return task_timing_stats_; }
+
 	 void AddTaskObserver(std::shared_ptr<TaskObserver> task_observer);
 	 void RemoveTaskObserver(std::shared_ptr<TaskObserver> task_observer);
 
@@ -227,19 +291,24 @@ class BASE_EXPORT MessageLoop : public MessagePump::Delegate,
 	 // 删除所有还没有运行的任务，主要用在析构函数.
 	 void DeletePendingTasks();
 
+	 // 如果现在有足够的空闲时间, 运行一个空闲任务并且返回true.
+	 bool RunNextIdleTask();
+
 	 // 唤醒message pump. 可以调用在任务的线程上.
 	 void SchedueWork();
 
 	 // MessasgePump::Delegate methods:
 	 bool DoWork() OVERRIDE;
-	 bool DoDelayedWork(
-		 std::chrono::milliseconds& next_delayed_work_time) OVERRIDE;
+	 bool DoDelayedWork(TimeTicks& next_delayed_work_time) OVERRIDE;
 	 bool DoIdleWork() OVERRIDE;
 
+	 // 根据还有没有需要高分辨率计时器的任务设置pump的timer slack.
+	 void UpdateTimerSlack();
+
 	 const Type type_;
 
-	 // A recent snapshot of Time::Now(), used to check delayed_work_queue_.
-	 std::chrono::milliseconds recent_time_;
+	 // A recent snapshot of TimeTicks::Now(), used to check delayed_work_queue_.
+	 TimeTicks recent_time_;
 
 
 	 std::list<std::shared_ptr<DestructionObserver>> destruction_observers_;
@@ -263,11 +332,32 @@ class BASE_EXPORT MessageLoop : public MessagePump::Delegate,
 	 // 保存着当前正在处理的任务，没有别的意思
 	 const PendingTask* current_pending_task_ = nullptr;
 
+	 struct PendingIdleTask {
+		 Location posted_from;
+		 IdleTask task;
+	 };
+
+	 // 这一次空闲时间可以运行的空闲任务. 它空了以后才把|next_idle_tasks_|
+	 // 移过来, 开始下一次空闲时间.
+	 std::queue<PendingIdleTask> idle_tasks_;
+	 std::queue<PendingIdleTask> next_idle_tasks_;
+	 // 开始一次空闲时间以后变成false, 运行了别的任务或者重新Run()以后变成true.
+	 bool idle_period_allowed_ = true;
+
+	 IdleTaskStats idle_task_stats_;
+
+	 TaskTimingStats task_timing_stats_;
+
 	 std::shared_ptr<internal::IncomingTaskQueue> incoming_task_queue_;
 
 	 // 一个我们还没有绑定到thread 上的task runner.
 	 std::shared_ptr<internal::MessageLoopTaskRunner> unbound_task_runner_;
 
+	 // 每个优先级的任务队列的task runner, 下标是TaskQueuePriority. kNormal的和
+	 // |unbound_task_runner_|是同一个.
+	 std::shared_ptr<internal::MessageLoopTaskRunner>
+		 priority_task_runners_[kTaskQueuePriorityCount];
+
 
 	 // 这个task runner 和memssage lopp 关联.
 	 std::shared_ptr<SingleThreadTaskRunner> task_runner_;
@@ -288,6 +378,54 @@ class BASE_EXPORT MessageLoop : public MessagePump::Delegate,
 
 };
 
+#if defined(OS_LINUX)
+
+// TYPE_IO 的消息循环, 除了任务以外还可以监视文件描述符.
+//
+// Sample usage:
+//   MessageLoopForIO::current()->WatchFileDescriptor(
+//       fd, true, MessageLoopForIO::WATCH_READ, &controller_, this);
+class BASE_EXPORT MessageLoopForIO : public MessageLoop {
+ public:
+	 using FdWatcher = MessagePumpEpoll::FdWatcher;
+	 using FdWatchController = MessagePumpEpoll::FdWatchController;
+	 using Trigger = MessagePumpEpoll::Trigger;
+
+	 enum Mode {
+		 WATCH_READ = MessagePumpEpoll::WATCH_READ,
+		 WATCH_WRITE = MessagePumpEpoll::WATCH_WRITE,
+		 WATCH_READ_WRITE = MessagePumpEpoll::WATCH_READ_WRITE,
+	 };
+
+	 MessageLoopForIO() : MessageLoop(TYPE_IO) {}
+
+	 // 当前线程的MessageLoop不是TYPE_IO的时候返回nullptr.
+	 static MessageLoopForIO* current() {
+		 MessageLoop* loop = MessageLoop::current();
+		 if (!loop || !loop->IsType(TYPE_IO))
+			 return nullptr;
+		 return static_cast<MessageLoopForIO*>(loop);
+	 }
+
+	 // 见MessagePumpEpoll::WatchFileDescriptor(), 只能在这个消息循环的线程上调用.
+	 bool WatchFileDescriptor(int fd,
+							  bool persistent,
+							  int mode,
+							  FdWatchController* controller,
+							  FdWatcher* watcher,
+							  Trigger trigger = Trigger::kLevel) {
+		 return static_cast<MessagePumpEpoll*>(pump_.get())->WatchFileDescriptor(
+			 fd, persistent, mode, controller, watcher, trigger);
+	 }
+};
+
+// MessageLoopForIO 只增加了方法, 没有增加成员, 所以可以把TYPE_IO的MessageLoop
+// 当作MessageLoopForIO使用.
+static_assert(sizeof(MessageLoop) == sizeof(MessageLoopForIO),
+			  "MessageLoopForIO should not have extra member variables");
+
+#endif	// defined(OS_LINUX)
+
 }
 
 #endif // !BASE_MESSAGE_LOOP_MESSAGE_LOOP_H
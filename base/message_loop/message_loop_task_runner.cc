@@ -17,10 +17,36 @@ namespace base {
 
 namespace internal {
 
+namespace {
+
+class CancelableTaskDelegate : public DelayedTaskHandle::Delegate {
+ public:
+	 explicit CancelableTaskDelegate(std::shared_ptr<CancelableTaskState> state)
+		 : state_(std::move(state)) {}
+
+	 bool IsValid() const OVERRIDE { return state_->pending; }
+
+	 void CancelTask() OVERRIDE {
+		 if (!state_->pending)
+			 return;
+		 state_->pending = false;
+		 // 还没有进入延迟队列的任务会在MessageLoop::DoWork()里面被丢掉.
+		 if (state_->queue)
+			 state_->queue->CancelDelayedTask(state_.get());
+	 }
+
+ private:
+	 std::shared_ptr<CancelableTaskState> state_;
+};
+
+}	// namespace .
 
 MessageLoopTaskRunner::MessageLoopTaskRunner(
-	std::shared_ptr<IncomingTaskQueue> incoming_queue) 
-	: incoming_queue_(incoming_queue){
+	std::shared_ptr<IncomingTaskQueue> incoming_queue,
+	TaskQueuePriority priority)
+	: incoming_queue_(incoming_queue),
+	  priority_(priority),
+	  valid_thread_id_(kInvalidThreadId) {
 }
 
 void MessageLoopTaskRunner::BindToCurrentThread() {
@@ -31,20 +57,43 @@ void MessageLoopTaskRunner::BindToCurrentThread() {
 
 bool MessageLoopTaskRunner::PostDelayedTask(const Location& from_here,
 											OnceClosure task,
-											std::chrono::milliseconds delay) {
+											TimeDelta delay) {
 	DCHECK(!task.is_null());
 
 	return incoming_queue_->AddToIncomingQueue(from_here, std::move(task), delay,
-											   Nestable::kNestable);
+											   Nestable::kNestable, priority_);
+}
+
+bool MessageLoopTaskRunner::PostTasks(const Location& from_here,
+									  std::vector<OnceClosure> tasks) {
+	return incoming_queue_->AddBatchToIncomingQueue(from_here, std::move(tasks),
+													Nestable::kNestable,
+													priority_);
 }
 
 bool MessageLoopTaskRunner::PostNonNestableDelayedTask(const Location& from_here,
 													   OnceClosure task,
-													   std::chrono::milliseconds delay) {
+													   TimeDelta delay) {
 	DCHECK(!task.is_null());
 
 	return incoming_queue_->AddToIncomingQueue(from_here, std::move(task), delay,
-											   Nestable::kNonNestable);
+											   Nestable::kNonNestable, priority_);
+}
+
+DelayedTaskHandle MessageLoopTaskRunner::PostCancelableDelayedTask(
+	const Location& from_here,
+	OnceClosure task,
+	TimeDelta delay) {
+	DCHECK(!task.is_null());
+
+	auto state = std::make_shared<CancelableTaskState>();
+	if (!incoming_queue_->AddToIncomingQueue(from_here, std::move(task), delay,
+											 Nestable::kNestable, priority_,
+											 state)) {
+		return DelayedTaskHandle();
+	}
+	return DelayedTaskHandle(
+		std::make_unique<CancelableTaskDelegate>(std::move(state)));
 }
 
 bool MessageLoopTaskRunner::RunsTasksInCurrentSequence() {
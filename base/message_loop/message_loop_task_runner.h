@@ -13,6 +13,7 @@
 #include <mutex>
 
 #include "base/base_export.h"
+#include "base/pending_task.h"
 #include "base/single_thread_task_runner.h"
 #include "base/threading/platform_thread.h"
 
@@ -28,19 +29,29 @@ class IncomingTaskQueue;
 
 class BASE_EXPORT MessageLoopTaskRunner : public SingleThreadTaskRunner {
  public:
+	// 提交的任务放进|incoming_queue|里面优先级为|priority|的队列.
 	explicit MessageLoopTaskRunner(
-		std::shared_ptr<IncomingTaskQueue> incoming_queue);
+		std::shared_ptr<IncomingTaskQueue> incoming_queue,
+		TaskQueuePriority priority = TaskQueuePriority::kNormal);
 
 	// Initialize this message loop task runner on the current thread.
 	void BindToCurrentThread();
 
 	bool PostDelayedTask(const Location& from_here,
 						 OnceClosure Task,
-						 std::chrono::milliseconds delay) OVERRIDE;
+						 TimeDelta delay) OVERRIDE;
+
+	bool PostTasks(const Location& from_here,
+				   std::vector<OnceClosure> tasks) OVERRIDE;
 
 	bool PostNonNestableDelayedTask(const Location& from_here,
 									OnceClosure task,
-									std::chrono::milliseconds delay) OVERRIDE;
+									TimeDelta delay) OVERRIDE;
+
+	// 取消的时候直接把任务从延迟队列里面删除.
+	DelayedTaskHandle PostCancelableDelayedTask(const Location& from_here,
+												OnceClosure task,
+												TimeDelta delay) OVERRIDE;
 
 	virtual bool RunsTasksInCurrentSequence() OVERRIDE;
 
@@ -51,6 +62,8 @@ class BASE_EXPORT MessageLoopTaskRunner : public SingleThreadTaskRunner {
 
 	 std::shared_ptr<IncomingTaskQueue> incoming_queue_;
 
+	 const TaskQueuePriority priority_;
+
 	 PlatformThreadId valid_thread_id_;
 	 std::mutex valid_thread_id_lock_;
 };
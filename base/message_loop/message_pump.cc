@@ -7,13 +7,26 @@
 */
 #include "base/message_loop/message_pump.h"
 
+#include "base/macor.h"
+
+#if defined(OS_LINUX)
+#include <sys/prctl.h>
+#endif
+
 namespace base {
 MessagePump::MessagePump() = default;
 
 MessagePump::~MessagePump() = default;
 
-void MessagePump::SetTimerSlack()
-{
+void MessagePump::SetTimerSlack(TimerSlack timer_slack) {
+	if (timer_slack == timer_slack_)
+		return;
+	timer_slack_ = timer_slack;
+
+#if defined(OS_LINUX)
+	// 1ns是允许的最小值, 0表示恢复成线程默认的值.
+	prctl(PR_SET_TIMERSLACK, timer_slack == TIMER_SLACK_NONE ? 1UL : 0UL);
+#endif
 }
 
 }
\ No newline at end of file
@@ -8,9 +8,8 @@
 #ifndef BASE_MESSAGE_LOOP_MESSAGE_PUMP_H
 #define BASE_MESSAGE_LOOP_MESSAGE_PUMP_H
 
-#include <chrono>
-
 #include "base/base_export.h"
+#include "base/time/time.h"
 
 namespace base {
 
@@ -22,12 +21,21 @@ class BASE_EXPORT MessagePump {
 
 		  virtual bool DoWork() = 0;
 
-		  virtual bool DoDelayedWork(
-			  std::chrono::milliseconds& next_delayed_work_time) = 0;
+		  // 运行一个到期的延迟任务, |next_delayed_work_time|被设置为下一个延迟
+		  // 任务的时间点, 没有延迟任务的时候设置为null.
+		  virtual bool DoDelayedWork(TimeTicks& next_delayed_work_time) = 0;
 
 		  virtual bool DoIdleWork() = 0;
 	 };
 
+	 // 等待延迟任务的时候允许的误差.
+	 enum TimerSlack {
+		 // 尽可能准时的醒来, 有需要高分辨率计时器的任务的时候使用.
+		 TIMER_SLACK_NONE,
+		 // 允许内核把唤醒推迟一点, 和其他的唤醒合并, 可以省电.
+		 TIMER_SLACK_MAXIMUM,
+	 };
+
 	 MessagePump();
 	 virtual ~MessagePump();
 
@@ -37,10 +45,19 @@ class BASE_EXPORT MessagePump {
 
 	 virtual void ScheduleWork() = 0;
 
-	 virtual void ScheduleDelayedWork(
-		 const std::chrono::milliseconds& delayed_time_work) = 0;
+	 // |delayed_work_time|是单调时钟上的时间点.
+	 virtual void ScheduleDelayedWork(const TimeTicks& delayed_work_time) = 0;
+
+	 // 只能在运行这个pump的线程上调用. 默认的实现在Linux上设置当前线程的
+	 // timer slack(prctl(PR_SET_TIMERSLACK)), 这会影响futex和epoll_wait的超时.
+	 virtual void SetTimerSlack(TimerSlack timer_slack);
+
+ protected:
+	 TimerSlack timer_slack() const { return timer_slack_; }
 
-	 virtual void SetTimerSlack();
+ private:
+	 // 线程默认的timer slack(一般是50us)就是TIMER_SLACK_MAXIMUM.
+	 TimerSlack timer_slack_ = TIMER_SLACK_MAXIMUM;
 };
 }
 
@@ -9,13 +9,21 @@
 
 namespace base {
 
-MessagePumpDefault::MessagePumpDefault() = default;
+MessagePumpDefault::MessagePumpDefault()
+	: work_scheduled_(false) {}
 
 MessagePumpDefault::~MessagePumpDefault() = default;
 
 // MessagePump methods:
 void MessagePumpDefault::Run(Delegate* delegate) {
+	// Quit()只结束这一次Run(), 之后(或者外层嵌套的)Run()还要继续运行.
+	const bool was_running = keep_running_.exchange(true);
+
 	for (;;) {
+		// 在做工作之前清除, 这样之后的ScheduleWork()会重新设置它, 我们睡眠之前
+		// 能够看到.
+		work_scheduled_.exchange(false, std::memory_order_seq_cst);
+
 		bool did_work = delegate->DoWork();
 		if (!keep_running_)
 			break;
@@ -37,40 +45,50 @@ void MessagePumpDefault::Run(Delegate* delegate) {
 		if (did_work)
 			continue;
 
-		std::unique_lock<std::mutex> lock(mutex_);
-		if (delayed_work_time_.count() == 0) {
-			event_.wait(lock);
+		EventCount::Key key = event_.PrepareWait();
+		// PrepareWait()之后必须再检查一次, 否则可能错过在这之间的ScheduleWork().
+		if (work_scheduled_.load(std::memory_order_seq_cst) || !keep_running_) {
+			event_.CancelWait();
+			continue;
+		}
+
+		if (delayed_work_time_.is_null()) {
+			event_.Wait(key);
 		}
 		else {
-			// 在这里原本是准备使用wait_until的，可是由于C++11的wait_until接受的参数
-			// 是time_point, 而我们保存的delayed_work_time_确实std::chrno::duration
-			// 类型，这两个类型之间的转换我弄了半天也没发现如何转换,所有改成了wait_for,
-			// 改成wait_for的话就需要计算等待的时长，而不是运行的时间.
-			auto now = std::chrono::system_clock::now();		
-			auto wait_time = 
-				delayed_work_time_ - std::chrono::duration_cast<
-				std::chrono::milliseconds>(now.time_since_epoch());
-			if (wait_time.count() <= 0)
+			// 精确到微秒的相对等待时长, 醒来的误差由timer slack决定.
+			const TimeDelta wait_time = delayed_work_time_ - TimeTicks::Now();
+			if (wait_time <= TimeDelta()) {
+				event_.CancelWait();
 				continue;
-			//event_.wait_until(lock, now);
-			event_.wait_for(lock, wait_time);
+			}
+			event_.WaitFor(key, wait_time.ToChrono());
 		}
-
 	}
+
+	keep_running_ = was_running;
 }
 
 void MessagePumpDefault::Quit() {
 	keep_running_ = false;
+	// 可能是在其他线程上调用的, 唤醒正在睡眠的Run().
+	event_.NotifyOne();
 }
 
 void MessagePumpDefault::ScheduleWork() {
-	std::lock_guard<std::mutex> lock(mutex_);
-	event_.notify_one();
+	// 上一次的ScheduleWork()还没有被Run()看到, Run()在睡眠之前一定会再检查
+	// 一次, 不需要做任何事.
+	if (work_scheduled_.load(std::memory_order_seq_cst) ||
+		work_scheduled_.exchange(true, std::memory_order_seq_cst)) {
+		return;
+	}
+	// 只有Run()在睡眠的时候才会进入内核.
+	event_.NotifyOne();
 }
 
 void MessagePumpDefault::ScheduleDelayedWork(
-	const  std::chrono::milliseconds& delayed_time_work) {
-	delayed_work_time_ = delayed_time_work;
+	const TimeTicks& delayed_work_time) {
+	delayed_work_time_ = delayed_work_time;
 }
 
 }
\ No newline at end of file
@@ -8,16 +8,19 @@
 #ifndef BASE_MESSAGE_LOOP_MESSAGE_PUMP_DEFAULT_H
 #define BASE_MESSAGE_LOOP_MESSAGE_PUMP_DEFAULT_H
 
-#include <chrono>
 #include <atomic>
-#include <condition_variable>
 
 #include "base/base_export.h"
 #include "base/macor.h"
 #include "base/message_loop/message_pump.h"
+#include "base/threading/event_count.h"
+#include "base/time/time.h"
 
 namespace base {
 
+// 没有事情做的时候在EventCount上睡眠(Linux上是futex). ScheduleWork()只有在
+// 上一次的ScheduleWork()已经被Run()看到, 并且Run()正在睡眠的时候才会进入内核,
+// message loop 正在处理任务的时候提交任务不会有系统调用.
 class BASE_EXPORT MessagePumpDefault : public MessagePump {
  public:
 	 MessagePumpDefault();
@@ -27,20 +30,20 @@ class BASE_EXPORT MessagePumpDefault : public MessagePump {
 	 void Run(Delegate* delegate) OVERRIDE;
 	 void Quit() OVERRIDE;
 	 void ScheduleWork() OVERRIDE;
-	 void ScheduleDelayedWork(
-		 const  std::chrono::milliseconds& delayed_time_work) OVERRIDE;
+	 void ScheduleDelayedWork(const TimeTicks& delayed_work_time) OVERRIDE;
 
  private:
 	 // This is flag is set to false when Run should return.
 	 std::atomic<bool> keep_running_ = true;
 	 
-	 // Used to sleep until there is more work to do.
-	 std::condition_variable event_;
+	 // ScheduleWork()以后为true, Run()每一轮开始的时候把它清除.
+	 std::atomic<bool> work_scheduled_;
 
-	 std::mutex mutex_;
+	 // Used to sleep until there is more work to do.
+	 EventCount event_;
 
-	 // the time at which we should call DodelayedWork.
-	 std::chrono::milliseconds delayed_work_time_;
+	 // the time at which we should call DodelayedWork. 只在Run()的线程上访问.
+	 TimeTicks delayed_work_time_;
 
 	 //DISALLOW_COPY_AND_ASSIGN(MessagePumpDefault);
 	 
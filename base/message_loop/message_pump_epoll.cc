@@ -0,0 +1,332 @@
+﻿/**
+* @Author: YangGuang
+* @Date:   2026-10-17
+* @Email:  guang334419520@126.com
+* @Filename: message_pump_epoll.cc
+* @Last modified by:  YangGuang
+*/
+#include "base/message_loop/message_pump_epoll.h"
+
+#include <errno.h>
+#include <limits.h>
+#include <stdint.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+
+#include "base/logging.h"
+
+namespace base {
+
+namespace {
+
+uint32_t EpollEventsForWatch(int mode, MessagePumpEpoll::Trigger trigger) {
+	uint32_t events = 0;
+	if (mode & MessagePumpEpoll::WATCH_READ)
+		events |= EPOLLIN | EPOLLRDHUP;
+	if (mode & MessagePumpEpoll::WATCH_WRITE)
+		events |= EPOLLOUT;
+	if (trigger == MessagePumpEpoll::Trigger::kEdge)
+		events |= EPOLLET;
+	return events;
+}
+
+}	// namespace.
+
+MessagePumpEpoll::FdWatchController::FdWatchController(
+	const Location& from_here)
+	: created_from_location_(from_here) {}
+
+MessagePumpEpoll::FdWatchController::~FdWatchController() {
+	StopWatchingFileDescriptor();
+	if (was_destroyed_)
+		*was_destroyed_ = true;
+}
+
+bool MessagePumpEpoll::FdWatchController::StopWatchingFileDescriptor() {
+	if (!pump_)
+		return true;
+	return pump_->StopWatching(this);
+}
+
+MessagePumpEpoll::MessagePumpEpoll()
+	: keep_running_(true),
+	  work_scheduled_(false),
+	  sleeping_(false),
+	  epoll_fd_(epoll_create1(EPOLL_CLOEXEC)),
+	  wakeup_fd_(eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK)),
+	  timer_fd_(timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC | TFD_NONBLOCK)) {
+	CHECK_GE(epoll_fd_, 0);
+	CHECK_GE(wakeup_fd_, 0);
+	CHECK_GE(timer_fd_, 0);
+
+	struct epoll_event event = {};
+	event.events = EPOLLIN;
+	event.data.fd = wakeup_fd_;
+	CHECK_EQ(epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, wakeup_fd_, &event), 0);
+
+	event.data.fd = timer_fd_;
+	CHECK_EQ(epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, timer_fd_, &event), 0);
+}
+
+MessagePumpEpoll::~MessagePumpEpoll() {
+	// 还没有析构的controller不能再指向我们.
+	for (auto& item : controllers_) {
+		item.second->pump_ = nullptr;
+		item.second->fd_ = -1;
+	}
+	controllers_.clear();
+
+	close(timer_fd_);
+	close(wakeup_fd_);
+	close(epoll_fd_);
+}
+
+bool MessagePumpEpoll::WatchFileDescriptor(int fd,
+										   bool persistent,
+										   int mode,
+										   FdWatchController* controller,
+										   FdWatcher* watcher,
+										   Trigger trigger) {
+	DCHECK_GE(fd, 0);
+	DCHECK(controller);
+	DCHECK(watcher);
+	DCHECK(mode & WATCH_READ_WRITE);
+
+	int op = EPOLL_CTL_ADD;
+	if (controller->pump_) {
+		DCHECK_EQ(controller->pump_, this);
+		if (controller->fd_ == fd) {
+			// 同一个fd, 合并监视的事件.
+			mode |= controller->mode_;
+			op = EPOLL_CTL_MOD;
+		}
+		else {
+			StopWatching(controller);
+		}
+	}
+	DCHECK(op == EPOLL_CTL_MOD || controllers_.count(fd) == 0);
+
+	struct epoll_event event = {};
+	event.events = EpollEventsForWatch(mode, trigger);
+	event.data.fd = fd;
+	if (epoll_ctl(epoll_fd_, op, fd, &event) != 0)
+		return false;
+
+	controller->pump_ = this;
+	controller->watcher_ = watcher;
+	controller->fd_ = fd;
+	controller->mode_ = mode;
+	controller->persistent_ = persistent;
+	controller->trigger_ = trigger;
+	controllers_[fd] = controller;
+	return true;
+}
+
+bool MessagePumpEpoll::StopWatching(FdWatchController* controller) {
+	DCHECK_EQ(controller->pump_, this);
+	const int fd = controller->fd_;
+	controllers_.erase(fd);
+	controller->pump_ = nullptr;
+	controller->watcher_ = nullptr;
+	controller->fd_ = -1;
+	controller->mode_ = 0;
+
+	// fd可能已经被关闭了, 关闭的fd会自动从epoll里面删除.
+	return epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, fd, nullptr) == 0 || errno == EBADF;
+}
+
+void MessagePumpEpoll::Run(Delegate* delegate) {
+	// Quit()只结束这一次Run(), 之后(或者外层嵌套的)Run()还要继续运行.
+	const bool was_running = keep_running_.exchange(true);
+
+	for (;;) {
+		work_scheduled_.exchange(false, std::memory_order_seq_cst);
+
+		bool did_work = delegate->DoWork();
+		if (!keep_running_)
+			break;
+
+		// 不等待的处理已经就绪的文件描述符, 这样任务很多的时候IO也不会饿死.
+		did_work |= WaitForEvents(0);
+		if (!keep_running_)
+			break;
+
+		did_work |= delegate->DoDelayedWork(delayed_work_time_);
+		if (!keep_running_)
+			break;
+
+		if (did_work)
+			continue;
+
+		did_work = delegate->DoIdleWork();
+		if (!keep_running_)
+			break;
+
+		if (did_work)
+			continue;
+
+		// 和ScheduleWork()配对: 要么我们在这里看到|work_scheduled_|, 要么
+		// ScheduleWork()看到|sleeping_|并且写|wakeup_fd_|.
+		sleeping_.store(true, std::memory_order_seq_cst);
+		if (work_scheduled_.load(std::memory_order_seq_cst) || !keep_running_) {
+			sleeping_.store(false, std::memory_order_relaxed);
+			continue;
+		}
+		WaitForEvents(PrepareDelayedWorkTimeout());
+		sleeping_.store(false, std::memory_order_relaxed);
+	}
+
+	keep_running_ = was_running;
+}
+
+void MessagePumpEpoll::Quit() {
+	keep_running_ = false;
+	// 可能是在其他线程上调用的.
+	ScheduleWork();
+}
+
+void MessagePumpEpoll::ScheduleWork() {
+	if (work_scheduled_.load(std::memory_order_seq_cst) ||
+		work_scheduled_.exchange(true, std::memory_order_seq_cst)) {
+		return;
+	}
+	if (!sleeping_.load(std::memory_order_seq_cst))
+		return;
+
+	const uint64_t value = 1;
+	ssize_t result;
+	do {
+		result = write(wakeup_fd_, &value, sizeof(value));
+	} while (result < 0 && errno == EINTR);
+	// EAGAIN 表示计数器已经满了, 这时候一定会被唤醒.
+	DCHECK(result == static_cast<ssize_t>(sizeof(value)) || errno == EAGAIN);
+}
+
+void MessagePumpEpoll::ScheduleDelayedWork(
+	const TimeTicks& delayed_work_time) {
+	delayed_work_time_ = delayed_work_time;
+}
+
+bool MessagePumpEpoll::WaitForEvents(int timeout_ms) {
+	struct epoll_event events[kMaxEvents];
+	const int count = epoll_wait(epoll_fd_, events, kMaxEvents, timeout_ms);
+	if (count < 0) {
+		DCHECK_EQ(errno, EINTR);
+		return false;
+	}
+
+	bool did_work = false;
+	for (int i = 0; i < count; ++i) {
+		const int fd = events[i].data.fd;
+		if (fd == wakeup_fd_) {
+			DrainWakeupFd();
+			continue;
+		}
+		if (fd == timer_fd_) {
+			// 到期的延迟任务由接下来的DoDelayedWork()处理.
+			DrainTimerFd();
+			continue;
+		}
+		OnFdReady(fd, events[i].events);
+		did_work = true;
+	}
+	return did_work;
+}
+
+void MessagePumpEpoll::OnFdReady(int fd, uint32_t events) {
+	// 同一批里面前面的回调可能已经停止监视这个fd了.
+	auto it = controllers_.find(fd);
+	if (it == controllers_.end())
+		return;
+
+	FdWatchController* controller = it->second;
+	FdWatcher* watcher = controller->watcher_;
+	const int mode = controller->mode_;
+	// 出错或者对端关闭的时候读和写都通知, 让FdWatcher自己从read()/write()
+	// 的返回值里面发现.
+	const bool error = (events & (EPOLLERR | EPOLLHUP | EPOLLRDHUP)) != 0;
+	const bool can_read = (mode & WATCH_READ) && ((events & EPOLLIN) || error);
+	const bool can_write = (mode & WATCH_WRITE) && ((events & EPOLLOUT) || error);
+
+	// 只通知一次的监视在回调之前停止, 这样回调里面可以重新开始监视.
+	const bool persistent = controller->persistent_;
+	if (!persistent)
+		StopWatching(controller);
+
+	// 回调里面可能会删除|controller|.
+	bool destroyed = false;
+	controller->was_destroyed_ = &destroyed;
+
+	if (can_write) {
+		watcher->OnFileCanWriteWithoutBlocking(fd);
+		if (destroyed)
+			return;
+	}
+
+	// 写的回调里面可能已经停止了监视.
+	if (can_read && (!persistent || controller->pump_ == this)) {
+		watcher->OnFileCanReadWithoutBlocking(fd);
+		if (destroyed)
+			return;
+	}
+	controller->was_destroyed_ = nullptr;
+}
+
+void MessagePumpEpoll::DrainWakeupFd() {
+	uint64_t value;
+	while (read(wakeup_fd_, &value, sizeof(value)) > 0) {
+	}
+}
+
+void MessagePumpEpoll::DrainTimerFd() {
+	uint64_t expirations;
+	while (read(timer_fd_, &expirations, sizeof(expirations)) > 0) {
+	}
+	// 一次性的定时器, 触发以后就不再是设置的状态了.
+	timer_fd_fire_time_ = TimeTicks();
+}
+
+int MessagePumpEpoll::PrepareDelayedWorkTimeout() {
+	if (delayed_work_time_.is_null() || timer_slack() != TIMER_SLACK_NONE) {
+		ArmTimerFd(TimeTicks());
+		return DelayedWorkTimeoutMs();
+	}
+
+	if (delayed_work_time_ <= TimeTicks::Now()) {
+		ArmTimerFd(TimeTicks());
+		return 0;
+	}
+	ArmTimerFd(delayed_work_time_);
+	return -1;
+}
+
+int MessagePumpEpoll::DelayedWorkTimeoutMs() const {
+	if (delayed_work_time_.is_null())
+		return -1;
+
+	const TimeDelta wait_time = delayed_work_time_ - TimeTicks::Now();
+	if (wait_time <= TimeDelta())
+		return 0;
+	// 向上取整, 否则会在延迟任务到期之前醒来, 然后空转到它到期.
+	const int64_t timeout_ms = wait_time.InMillisecondsRoundedUp();
+	return timeout_ms > INT_MAX ? INT_MAX : static_cast<int>(timeout_ms);
+}
+
+void MessagePumpEpoll::ArmTimerFd(TimeTicks fire_time) {
+	if (fire_time == timer_fd_fire_time_)
+		return;
+
+	// it_value全是0的时候表示取消.
+	struct itimerspec spec = {};
+	if (!fire_time.is_null()) {
+		const int64_t us = fire_time.since_origin().InMicroseconds();
+		spec.it_value.tv_sec = static_cast<time_t>(us / (1000 * 1000));
+		spec.it_value.tv_nsec = static_cast<long>(us % (1000 * 1000)) * 1000;
+	}
+	CHECK_EQ(timerfd_settime(timer_fd_, TFD_TIMER_ABSTIME, &spec, nullptr), 0);
+	timer_fd_fire_time_ = fire_time;
+}
+
+}	// namespace base.
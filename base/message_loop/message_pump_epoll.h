@@ -0,0 +1,165 @@
+﻿/**
+* @Author: YangGuang
+* @Date:   2026-10-17
+* @Email:  guang334419520@126.com
+* @Filename: message_pump_epoll.h
+* @Last modified by:  YangGuang
+*/
+#ifndef BASE_MESSAGE_LOOP_MESSAGE_PUMP_EPOLL_H
+#define BASE_MESSAGE_LOOP_MESSAGE_PUMP_EPOLL_H
+
+#include <atomic>
+#include <unordered_map>
+
+#include "base/base_export.h"
+#include "base/location.h"
+#include "base/macor.h"
+#include "base/message_loop/message_pump.h"
+#include "base/time/time.h"
+
+namespace base {
+
+// TYPE_IO 的message loop 使用的message pump, 除了任务以外还可以等待文件描述符
+// 可读/可写. 所有的文件描述符和一个用来唤醒的eventfd放在同一个epoll里面, 没有
+// 事情做的时候在epoll_wait()里面睡眠.
+//
+// 和MessagePumpDefault一样, ScheduleWork()只有在Run()正在epoll_wait()里面睡眠
+// 的时候才会写eventfd, message loop 正在处理任务的时候提交任务没有系统调用.
+//
+// 延迟任务默认用epoll_wait()的超时来等待, 只能精确到毫秒(向上取整). timer slack
+// 是TIMER_SLACK_NONE的时候(有需要高分辨率计时器的任务), 改为用一个同样在epoll
+// 里面的timerfd来等待, 可以精确到微秒.
+//
+// 除了ScheduleWork()以外，所有的方法都只能在运行这个pump的线程上调用.
+class BASE_EXPORT MessagePumpEpoll : public MessagePump {
+ public:
+	 // 文件描述符就绪的时候在message loop 的线程上被调用. 回调里面可以停止监视,
+	 // 也可以删除对应的FdWatchController.
+	 class BASE_EXPORT FdWatcher {
+	  public:
+		  virtual void OnFileCanReadWithoutBlocking(int fd) = 0;
+		  virtual void OnFileCanWriteWithoutBlocking(int fd) = 0;
+
+	  protected:
+		  virtual ~FdWatcher() = default;
+	 };
+
+	 enum Mode {
+		 WATCH_READ = 1 << 0,
+		 WATCH_WRITE = 1 << 1,
+		 WATCH_READ_WRITE = WATCH_READ | WATCH_WRITE,
+	 };
+
+	 enum class Trigger {
+		 // 只要还可以读/写, 每一轮都会通知.
+		 kLevel,
+		 // 只有状态变化的时候通知一次, FdWatcher必须一直读/写到EAGAIN.
+		 kEdge,
+	 };
+
+	 // 代表对一个文件描述符的监视, 析构的时候停止监视.
+	 class BASE_EXPORT FdWatchController {
+	  public:
+		  explicit FdWatchController(const Location& from_here);
+		  ~FdWatchController();
+
+		  // 停止监视, 没有在监视的时候什么都不做. 成功返回true.
+		  bool StopWatchingFileDescriptor();
+
+		  const Location& created_from_location() const {
+			  return created_from_location_;
+		  }
+
+	  private:
+		  friend class MessagePumpEpoll;
+
+		  const Location created_from_location_;
+		  MessagePumpEpoll* pump_ = nullptr;
+		  FdWatcher* watcher_ = nullptr;
+		  int fd_ = -1;
+		  int mode_ = 0;
+		  bool persistent_ = false;
+		  Trigger trigger_ = Trigger::kLevel;
+		  // 正在分发事件的时候指向MessagePumpEpoll栈上的变量, 析构的时候设置为
+		  // true, 这样回调里面可以安全的删除controller.
+		  bool* was_destroyed_ = nullptr;
+
+		  DISALLOW_COPY_AND_ASSIGN(FdWatchController);
+	 };
+
+	 MessagePumpEpoll();
+	 ~MessagePumpEpoll() OVERRIDE;
+
+	 // 开始监视|fd|, 就绪的时候调用|watcher|. |persistent|为false的时候只通知
+	 // 一次, 之后自动停止监视. |controller|已经在监视同一个|fd|的时候, 新的
+	 // |mode|会和原来的合并. 一个|fd|同一时间只能有一个|controller|.
+	 bool WatchFileDescriptor(int fd,
+							  bool persistent,
+							  int mode,
+							  FdWatchController* controller,
+							  FdWatcher* watcher,
+							  Trigger trigger = Trigger::kLevel);
+
+	 // MessagePump methods:
+	 void Run(Delegate* delegate) OVERRIDE;
+	 void Quit() OVERRIDE;
+	 void ScheduleWork() OVERRIDE;
+	 void ScheduleDelayedWork(const TimeTicks& delayed_work_time) OVERRIDE;
+
+ private:
+	 // 一次epoll_wait()最多取出的事件数量.
+	 static constexpr int kMaxEvents = 256;
+
+	 bool StopWatching(FdWatchController* controller);
+
+	 // 等待最多|timeout_ms|毫秒(-1表示一直等待), 然后分发就绪的事件. 有文件描述符
+	 // 的回调被调用返回true.
+	 bool WaitForEvents(int timeout_ms);
+
+	 void OnFdReady(int fd, uint32_t events);
+
+	 // 清空|wakeup_fd_|的计数.
+	 void DrainWakeupFd();
+
+	 // 清空|timer_fd_|的计数.
+	 void DrainTimerFd();
+
+	 // 睡眠之前调用, 返回epoll_wait()的超时(毫秒). 高分辨率的时候把|timer_fd_|
+	 // 设置到|delayed_work_time_|, 然后返回-1.
+	 int PrepareDelayedWorkTimeout();
+
+	 // 到|delayed_work_time_|还需要等待的毫秒数, 没有延迟任务返回-1.
+	 int DelayedWorkTimeoutMs() const;
+
+	 // 把|timer_fd_|设置为在|fire_time|触发, null表示取消.
+	 void ArmTimerFd(TimeTicks fire_time);
+
+	 // This is flag is set to false when Run should return.
+	 std::atomic<bool> keep_running_;
+
+	 // ScheduleWork()以后为true, Run()每一轮开始的时候把它清除.
+	 std::atomic<bool> work_scheduled_;
+
+	 // Run()将要或者正在epoll_wait()里面睡眠的时候为true, 只有这时ScheduleWork()
+	 // 才需要写|wakeup_fd_|.
+	 std::atomic<bool> sleeping_;
+
+	 int epoll_fd_;
+	 int wakeup_fd_;
+	 int timer_fd_;
+
+	 // |timer_fd_|现在设置的触发时间, null表示没有设置.
+	 TimeTicks timer_fd_fire_time_;
+
+	 // 正在监视的文件描述符.
+	 std::unordered_map<int, FdWatchController*> controllers_;
+
+	 // the time at which we should call DodelayedWork.
+	 TimeTicks delayed_work_time_;
+
+	 DISALLOW_COPY_AND_ASSIGN(MessagePumpEpoll);
+};
+
+}	// namespace base.
+
+#endif // !BASE_MESSAGE_LOOP_MESSAGE_PUMP_EPOLL_H
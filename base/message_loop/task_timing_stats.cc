@@ -0,0 +1,173 @@
+﻿/**
+* @Author: YangGuang
+* @Date:   2026-10-17
+* @Email:  guang334419520@126.com
+* @Filename: task_timing_stats.cc
+* @Last modified by:  YangGuang
+*/
+#include "base/message_loop/task_timing_stats.h"
+
+#include <inttypes.h>
+#include <stdio.h>
+
+#include <algorithm>
+
+#include "base/logging.h"
+#include "base/pending_task.h"
+
+namespace base {
+
+namespace {
+
+int BucketOf(TimeDelta delta) {
+	const int64_t us = delta.InMicroseconds();
+	int bucket = 0;
+	while (bucket < TaskTimingStats::kBucketCount - 1 &&
+		   (int64_t(2) << bucket) <= us)
+		++bucket;
+	return bucket;
+}
+
+TimeDelta Percentile(const uint32_t (&histogram)[TaskTimingStats::kBucketCount],
+					 uint64_t count,
+					 double percentile) {
+	if (count == 0)
+		return TimeDelta();
+	const double target = count * percentile / 100;
+	uint64_t seen = 0;
+	for (int bucket = 0; bucket < TaskTimingStats::kBucketCount; ++bucket) {
+		seen += histogram[bucket];
+		if (seen >= target && seen > 0)
+			return TimeDelta::FromMicroseconds(int64_t(2) << bucket);
+	}
+	return TimeDelta::Max();
+}
+
+void Record(TimeDelta delta,
+			TimeDelta* total,
+			TimeDelta* max,
+			uint32_t (&histogram)[TaskTimingStats::kBucketCount]) {
+	// 延迟任务可能提前一点点被取出来.
+	delta = std::max(delta, TimeDelta());
+	*total += delta;
+	*max = std::max(*max, delta);
+	++histogram[BucketOf(delta)];
+}
+
+std::vector<TaskTimingStats::Site> TopSites(
+	const std::unordered_map<const void*, TaskTimingStats::Site>& sites,
+	size_t max_sites,
+	TimeDelta TaskTimingStats::Site::* key) {
+	std::vector<TaskTimingStats::Site> result;
+	result.reserve(sites.size());
+	for (const auto& site : sites)
+		result.push_back(site.second);
+
+	auto greater = [key](const TaskTimingStats::Site& a,
+						 const TaskTimingStats::Site& b) {
+		return a.*key > b.*key;
+	};
+	if (result.size() > max_sites) {
+		std::partial_sort(result.begin(), result.begin() + max_sites,
+						  result.end(), greater);
+		result.resize(max_sites);
+	}
+	else {
+		std::sort(result.begin(), result.end(), greater);
+	}
+	return result;
+}
+
+void AppendSites(const char* title,
+				 const std::vector<TaskTimingStats::Site>& sites,
+				 std::string* output) {
+	char line[256];
+	snprintf(line, sizeof(line),
+			 "%s\n%10s %12s %10s %10s %12s %10s %10s  %s\n", title, "count",
+			 "run_total", "run_p99", "run_max", "queue_total", "queue_p99",
+			 "queue_max", "posted_from");
+	output->append(line);
+	for (const auto& site : sites) {
+		snprintf(line, sizeof(line),
+				 "%10" PRIu64 " %12" PRId64 " %10" PRId64 " %10" PRId64
+				 " %12" PRId64 " %10" PRId64 " %10" PRId64 "  ",
+				 site.count,
+				 site.total_run_time.InMicroseconds(),
+				 site.RunTimePercentile(99).InMicroseconds(),
+				 site.max_run_time.InMicroseconds(),
+				 site.total_queue_time.InMicroseconds(),
+				 site.QueueTimePercentile(99).InMicroseconds(),
+				 site.max_queue_time.InMicroseconds());
+		output->append(line);
+		output->append(site.posted_from.ToString());
+		output->push_back('\n');
+	}
+}
+
+}	// namespace .
+
+constexpr int TaskTimingStats::kBucketCount;
+
+std::atomic<bool> TaskTimingStats::enabled_(false);
+
+TimeDelta TaskTimingStats::Site::QueueTimePercentile(double percentile) const {
+	return Percentile(queue_time_histogram, count, percentile);
+}
+
+TimeDelta TaskTimingStats::Site::RunTimePercentile(double percentile) const {
+	return Percentile(run_time_histogram, count, percentile);
+}
+
+TaskTimingStats::TaskTimingStats() : task_count_(0) {}
+
+TaskTimingStats::~TaskTimingStats() = default;
+
+// static.
+void TaskTimingStats::SetEnabled(bool enabled) {
+	enabled_.store(enabled, std::memory_order_relaxed);
+}
+
+void TaskTimingStats::RecordTask(const PendingTask& pending_task,
+								 TimeTicks start_time,
+								 TimeTicks end_time) {
+	DCHECK(!pending_task.queue_time.is_null());
+
+	Site& site = sites_[pending_task.posted_from.program_counter()];
+	if (site.count == 0)
+		site.posted_from = pending_task.posted_from;
+	++site.count;
+	++task_count_;
+
+	// 延迟任务从它应该运行的时间开始算, 这样只统计被别的任务耽误的时间.
+	const TimeTicks ready_time = std::max(pending_task.queue_time,
+										  pending_task.delayed_run_time);
+	Record(start_time - ready_time, &site.total_queue_time,
+		   &site.max_queue_time, site.queue_time_histogram);
+	Record(end_time - start_time, &site.total_run_time, &site.max_run_time,
+		   site.run_time_histogram);
+}
+
+std::vector<TaskTimingStats::Site> TaskTimingStats::GetSlowestSites(
+	size_t max_sites) const {
+	return TopSites(sites_, max_sites, &Site::total_run_time);
+}
+
+std::vector<TaskTimingStats::Site> TaskTimingStats::GetMostQueuedSites(
+	size_t max_sites) const {
+	return TopSites(sites_, max_sites, &Site::total_queue_time);
+}
+
+std::string TaskTimingStats::Dump(size_t max_sites) const {
+	std::string output;
+	AppendSites("slowest sites (us):", GetSlowestSites(max_sites), &output);
+	AppendSites("most queued sites (us):", GetMostQueuedSites(max_sites),
+				&output);
+	return output;
+}
+
+void TaskTimingStats::Reset() {
+	sites_.clear();
+	task_count_ = 0;
+}
+
+}	// namespace base.
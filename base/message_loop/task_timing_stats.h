@@ -0,0 +1,99 @@
+﻿/**
+* @Author: YangGuang
+* @Date:   2026-10-17
+* @Email:  guang334419520@126.com
+* @Filename: task_timing_stats.h
+* @Last modified by:  YangGuang
+*/
+#ifndef BASE_MESSAGE_LOOP_TASK_TIMING_STATS_H
+#define BASE_MESSAGE_LOOP_TASK_TIMING_STATS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "base/base_export.h"
+#include "base/location.h"
+#include "base/macor.h"
+#include "base/time/time.h"
+
+namespace base {
+
+struct PendingTask;
+
+// 按照提交任务的位置(Location的program counter)统计一个线程上的任务等了多久
+// 才开始运行(排队时间)和运行了多久, 用来找出拖慢消息循环的任务.
+//
+// 统计默认是关闭的, 用SetEnabled()在运行的时候打开. 关闭的时候提交任务只多读一次
+// 原子变量, 运行任务只多判断一次PendingTask::queue_time是不是null. 每个
+// MessageLoop有自己的TaskTimingStats, 只能在它的线程上访问, 所以记录的时候不用加锁.
+class BASE_EXPORT TaskTimingStats {
+ public:
+	 // 直方图的桶数, 第i个桶是[2^i, 2^(i+1))微秒, 第0个桶还包括0, 最后一个桶
+	 // 包括所有更长的时间.
+	 static constexpr int kBucketCount = 24;
+
+	 // 一个提交位置的统计.
+	 struct Site {
+		 Location posted_from;
+		 uint64_t count = 0;
+
+		 // 从提交(延迟任务从它应该运行的时间)到开始运行.
+		 TimeDelta total_queue_time;
+		 TimeDelta max_queue_time;
+		 uint32_t queue_time_histogram[kBucketCount] = {};
+
+		 TimeDelta total_run_time;
+		 TimeDelta max_run_time;
+		 uint32_t run_time_histogram[kBucketCount] = {};
+
+		 // 根据直方图估计百分位数, 返回所在的桶的上界. |percentile|在0到100之间.
+		 TimeDelta QueueTimePercentile(double percentile) const;
+		 TimeDelta RunTimePercentile(double percentile) const;
+	 };
+
+	 TaskTimingStats();
+	 ~TaskTimingStats();
+
+	 // 所有线程共用一个开关. 打开以前提交的任务不会被统计.
+	 static void SetEnabled(bool enabled);
+	 static bool IsEnabled() {
+		 return enabled_.load(std::memory_order_relaxed);
+	 }
+
+	 // 记录一个已经运行完的任务, |pending_task|提交的时候统计必须是打开的.
+	 void RecordTask(const PendingTask& pending_task,
+					 TimeTicks start_time,
+					 TimeTicks end_time);
+
+	 // 按照总的运行时间从大到小, 最多返回|max_sites|个位置.
+	 std::vector<Site> GetSlowestSites(size_t max_sites) const;
+
+	 // 按照总的排队时间从大到小, 最多返回|max_sites|个位置.
+	 std::vector<Site> GetMostQueuedSites(size_t max_sites) const;
+
+	 // 把上面两个列表转换成方便阅读的文本, 每个列表最多|max_sites|行.
+	 std::string Dump(size_t max_sites) const;
+
+	 // 清空所有的统计.
+	 void Reset();
+
+	 // 一共记录了多少个任务.
+	 uint64_t task_count() const { return task_count_; }
+
+ private:
+	 static std::atomic<bool> enabled_;
+
+	 std::unordered_map<const void*, Site> sites_;
+	 uint64_t task_count_;
+
+	 DISALLOW_COPY_AND_ASSIGN(TaskTimingStats);
+};
+
+}	// namespace base.
+
+#endif // !BASE_MESSAGE_LOOP_TASK_TIMING_STATS_H
@@ -0,0 +1,321 @@
+﻿/**
+* @Author: YangGuang
+* @Date:   2026-10-17
+* @Email:  guang334419520@126.com
+* @Filename: timing_wheel.cc
+* @Last modified by:  YangGuang
+*/
+#include "base/message_loop/timing_wheel.h"
+
+#include <algorithm>
+#include <new>
+#include <utility>
+
+#include "base/logging.h"
+
+namespace base {
+
+namespace internal {
+
+namespace {
+
+// |value|不能为0.
+int LowestBit(uint64_t value) {
+#if defined(COMPILER_GCC) || defined(__clang__)
+	return __builtin_ctzll(value);
+#else
+	int bit = 0;
+	while (!(value & 1)) {
+		value >>= 1;
+		++bit;
+	}
+	return bit;
+#endif
+}
+
+// |value|不能为0.
+int HighestBit(uint64_t value) {
+#if defined(COMPILER_GCC) || defined(__clang__)
+	return 63 - __builtin_clzll(value);
+#else
+	int bit = 0;
+	while (value >>= 1)
+		++bit;
+	return bit;
+#endif
+}
+
+}	// namespace .
+
+struct TimingWheelNode {
+	explicit TimingWheelNode(PendingTask pending_task)
+		: task(std::move(pending_task)) {}
+
+	PendingTask task;
+	// 同一个槽位里面的任务组成一个双向链表, 这样取消是O(1)的.
+	TimingWheelNode* prev = nullptr;
+	TimingWheelNode* next = nullptr;
+	int64_t tick = 0;
+	int level = TimingWheel::kDueLevel;
+	int slot = 0;
+	// 只有在|due_|里面的节点会被标记, 其他的节点取消的时候直接删除.
+	bool cancelled = false;
+};
+
+namespace {
+
+// 和DelayedTaskHeap一样, 最早的任务在堆顶.
+bool NodeRunsLater(const TimingWheel::Node* a, const TimingWheel::Node* b) {
+	return a->task < b->task;
+}
+
+}	// namespace .
+
+constexpr int TimingWheel::kLevelBits;
+constexpr int TimingWheel::kSlotsPerLevel;
+constexpr int TimingWheel::kLevels;
+constexpr int TimingWheel::kDueLevel;
+constexpr int TimingWheel::kFarLevel;
+constexpr std::size_t TimingWheel::kMaxFreeNodes;
+
+TimingWheel::TimingWheel(TimeDelta tick)
+	: tick_us_(std::max<int64_t>(1, tick.InMicroseconds())),
+	  cursor_(0),
+	  far_(nullptr),
+	  size_(0),
+	  free_nodes_(nullptr),
+	  free_node_count_(0) {
+	cursor_ = TickOf(TimeTicks::Now());
+	std::fill(std::begin(occupied_), std::end(occupied_), 0);
+	for (auto& level : slots_)
+		std::fill(std::begin(level), std::end(level), nullptr);
+}
+
+TimingWheel::~TimingWheel() {
+	Clear();
+	while (free_nodes_) {
+		void* memory = free_nodes_;
+		free_nodes_ = *static_cast<void**>(memory);
+		::operator delete(memory);
+	}
+}
+
+TimingWheel::Handle TimingWheel::Push(PendingTask pending_task) {
+	DCHECK(!pending_task.delayed_run_time.is_null());
+
+	if (size_ == 0) {
+		// 时间轮是空的, 让|cursor_|回到现在, 这样新的任务都能放进时间轮而不是
+		// |due_|. |due_|里面可能还有被取消的节点.
+		DropCancelledDue();
+		DCHECK(due_.empty());
+		cursor_ = TickOf(TimeTicks::Now());
+	}
+
+	Node* node = NewNode(std::move(pending_task));
+	node->tick = TickOf(node->task.delayed_run_time);
+	Place(node);
+	++size_;
+	return node;
+}
+
+const PendingTask& TimingWheel::Peek() {
+	DCHECK(!empty());
+	DropCancelledDue();
+	if (due_.empty())
+		FillDue();
+	return due_.front()->task;
+}
+
+PendingTask TimingWheel::Pop() {
+	Peek();
+	std::pop_heap(due_.begin(), due_.end(), &NodeRunsLater);
+	Node* node = due_.back();
+	due_.pop_back();
+
+	PendingTask pending_task = std::move(node->task);
+	DeleteNode(node);
+	--size_;
+	return pending_task;
+}
+
+void TimingWheel::Cancel(Handle handle) {
+	DCHECK(handle);
+	DCHECK(!handle->cancelled);
+	--size_;
+
+	if (handle->level == kDueLevel) {
+		// 不能直接从堆的中间删除, 等它到堆顶的时候再删除. 先释放任务持有的资源.
+		handle->cancelled = true;
+		handle->task.task.Reset();
+		return;
+	}
+	Unlink(handle);
+	DeleteNode(handle);
+}
+
+// static.
+const PendingTask& TimingWheel::GetTask(Handle handle) {
+	DCHECK(handle);
+	return handle->task;
+}
+
+void TimingWheel::Clear() {
+	for (int level = 0; level < kLevels; ++level) {
+		for (int slot = 0; slot < kSlotsPerLevel; ++slot) {
+			Node* node = slots_[level][slot];
+			while (node) {
+				Node* next = node->next;
+				DeleteNode(node);
+				node = next;
+			}
+			slots_[level][slot] = nullptr;
+		}
+		occupied_[level] = 0;
+	}
+
+	while (far_) {
+		Node* next = far_->next;
+		DeleteNode(far_);
+		far_ = next;
+	}
+
+	for (Node* node : due_)
+		DeleteNode(node);
+	due_.clear();
+	size_ = 0;
+}
+
+int64_t TimingWheel::TickOf(TimeTicks time) const {
+	return time.since_origin().InMicroseconds() / tick_us_;
+}
+
+void TimingWheel::Place(Node* node) {
+	node->prev = nullptr;
+	node->next = nullptr;
+
+	if (node->tick <= cursor_) {
+		node->level = kDueLevel;
+		due_.push_back(node);
+		std::push_heap(due_.begin(), due_.end(), &NodeRunsLater);
+		return;
+	}
+
+	const uint64_t diff =
+		static_cast<uint64_t>(node->tick) ^ static_cast<uint64_t>(cursor_);
+	const int level = HighestBit(diff) / kLevelBits;
+	Node** head;
+	if (level >= kLevels) {
+		node->level = kFarLevel;
+		head = &far_;
+	}
+	else {
+		const int slot = static_cast<int>(
+			(node->tick >> (level * kLevelBits)) & (kSlotsPerLevel - 1));
+		node->level = level;
+		node->slot = slot;
+		head = &slots_[level][slot];
+		occupied_[level] |= uint64_t(1) << slot;
+	}
+
+	node->next = *head;
+	if (*head)
+		(*head)->prev = node;
+	*head = node;
+}
+
+void TimingWheel::Unlink(Node* node) {
+	DCHECK(node->level != kDueLevel);
+
+	Node** head = node->level == kFarLevel ? &far_
+		: &slots_[node->level][node->slot];
+	if (node->prev)
+		node->prev->next = node->next;
+	else
+		*head = node->next;
+	if (node->next)
+		node->next->prev = node->prev;
+
+	if (!*head && node->level != kFarLevel)
+		occupied_[node->level] &= ~(uint64_t(1) << node->slot);
+}
+
+void TimingWheel::FillDue() {
+	while (due_.empty()) {
+		int level = 0;
+		while (level < kLevels && !occupied_[level])
+			++level;
+
+		Node* list;
+		if (level < kLevels) {
+			// 同一层里面槽位越小越早, 把|cursor_|移到这个槽位的开始. 所有比它早的
+			// 格子都没有任务了, 所以其他层的任务的位置不会变.
+			const int slot = LowestBit(occupied_[level]);
+			const int shift = level * kLevelBits;
+			const uint64_t upper_mask =
+				~((uint64_t(1) << (shift + kLevelBits)) - 1);
+			cursor_ = static_cast<int64_t>(
+				(static_cast<uint64_t>(cursor_) & upper_mask) |
+				(static_cast<uint64_t>(slot) << shift));
+
+			list = slots_[level][slot];
+			slots_[level][slot] = nullptr;
+			occupied_[level] &= ~(uint64_t(1) << slot);
+		}
+		else {
+			// 所有的层都是空的, 直接跳到最早的一个很远的任务.
+			DCHECK(far_);
+			int64_t earliest = far_->tick;
+			for (Node* node = far_->next; node; node = node->next)
+				earliest = std::min(earliest, node->tick);
+			cursor_ = earliest;
+
+			list = far_;
+			far_ = nullptr;
+		}
+
+		// 这些任务都会落到更低的层或者|due_|里面, 每一个任务最多被重新分配
+		// kLevels次.
+		while (list) {
+			Node* next = list->next;
+			Place(list);
+			list = next;
+		}
+	}
+}
+
+void TimingWheel::DropCancelledDue() {
+	while (!due_.empty() && due_.front()->cancelled) {
+		std::pop_heap(due_.begin(), due_.end(), &NodeRunsLater);
+		DeleteNode(due_.back());
+		due_.pop_back();
+	}
+}
+
+TimingWheel::Node* TimingWheel::NewNode(PendingTask pending_task) {
+	void* memory;
+	if (free_nodes_) {
+		memory = free_nodes_;
+		free_nodes_ = *static_cast<void**>(memory);
+		--free_node_count_;
+	}
+	else {
+		memory = ::operator new(sizeof(Node));
+	}
+	return new (memory) Node(std::move(pending_task));
+}
+
+void TimingWheel::DeleteNode(Node* node) {
+	node->~TimingWheelNode();
+	if (free_node_count_ < kMaxFreeNodes) {
+		*reinterpret_cast<void**>(node) = free_nodes_;
+		free_nodes_ = node;
+		++free_node_count_;
+	}
+	else {
+		::operator delete(node);
+	}
+}
+
+}	// namespace internal.
+
+}	// namespace base.
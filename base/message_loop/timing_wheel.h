@@ -0,0 +1,128 @@
+﻿/**
+* @Author: YangGuang
+* @Date:   2026-10-17
+* @Email:  guang334419520@126.com
+* @Filename: timing_wheel.h
+* @Last modified by:  YangGuang
+*/
+#ifndef BASE_MESSAGE_LOOP_TIMING_WHEEL_H
+#define BASE_MESSAGE_LOOP_TIMING_WHEEL_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <vector>
+
+#include "base/base_export.h"
+#include "base/macor.h"
+#include "base/pending_task.h"
+#include "base/time/time.h"
+
+namespace base {
+
+namespace internal {
+
+struct TimingWheelNode;
+
+// 保存延迟任务的分层时间轮, 可以代替DelayedTaskHeap(二叉堆). 插入和取消都是
+// O(1)的, 取出是均摊O(1)的, 适合一个线程上有几十万个超时任务的情况.
+//
+// 时间被分成|tick|长的格子, 一共kLevels层, 每一层kSlotsPerLevel个槽位. 一个任务
+// 放在哪一层取决于它的格子和|cursor_|从哪一层开始不同(异或以后最高的不同位), 所以
+// 低层的任务一定比高层的任务早, 同一层里面槽位小的一定比槽位大的早. 超出所有层的
+// 任务放在|far_|里面.
+//
+// 需要最早的任务的时候, 把最早的一个非空槽位拿出来, 把|cursor_|移到这个槽位的
+// 开始, 然后把里面的任务重新放到更低的层. 格子不晚于|cursor_|的任务放在一个小的
+// 二叉堆|due_|里面, 按照(delayed_run_time, sequence_num)排序, 所以Peek()返回的
+// 总是真正最早的任务, 相同时间的任务保持先进先出, 和DelayedTaskHeap的顺序一样.
+// |tick|只影响每个槽位里面有多少任务, 不影响任务运行的精度.
+//
+// 只能在一个线程上使用.
+class BASE_EXPORT TimingWheel {
+ public:
+	 using Node = TimingWheelNode;
+	 // Push()返回的句柄, 任务被Pop()或者Cancel()以后就失效了.
+	 using Handle = Node*;
+
+	 explicit TimingWheel(TimeDelta tick = TimeDelta::FromMilliseconds(1));
+	 ~TimingWheel();
+
+	 // |pending_task|必须是一个延迟任务.
+	 Handle Push(PendingTask pending_task);
+
+	 // 返回最早的任务, 时间轮不能为空.
+	 const PendingTask& Peek();
+
+	 // 删除并且返回最早的任务, 时间轮不能为空.
+	 PendingTask Pop();
+
+	 // 删除|handle|对应的还没有运行的任务.
+	 void Cancel(Handle handle);
+
+	 // 返回|handle|对应的任务.
+	 static const PendingTask& GetTask(Handle handle);
+
+	 // 删除所有的任务.
+	 void Clear();
+
+	 bool empty() const { return size_ == 0; }
+	 std::size_t size() const { return size_; }
+
+ private:
+	 friend struct TimingWheelNode;
+
+	 static constexpr int kLevelBits = 6;
+	 static constexpr int kSlotsPerLevel = 1 << kLevelBits;
+	 static constexpr int kLevels = 6;
+	 // |Node::level|的两个特殊值.
+	 static constexpr int kDueLevel = -1;
+	 static constexpr int kFarLevel = kLevels;
+	 // 最多缓存的空闲节点数量.
+	 static constexpr std::size_t kMaxFreeNodes = 1024;
+
+	 int64_t TickOf(TimeTicks time) const;
+
+	 // 根据|cursor_|把|node|放进|due_|、某一层的槽位或者|far_|.
+	 void Place(Node* node);
+
+	 // 从所在的槽位链表里面摘下来, |node|不能在|due_|里面.
+	 void Unlink(Node* node);
+
+	 // |due_|为空的时候调用, 把最早的一个非空槽位里面的任务重新分配, 直到
+	 // |due_|里面有任务.
+	 void FillDue();
+
+	 // 删除|due_|顶部已经被取消的节点.
+	 void DropCancelledDue();
+
+	 Node* NewNode(PendingTask pending_task);
+	 void DeleteNode(Node* node);
+
+	 const int64_t tick_us_;
+
+	 // 所有不在|due_|里面的任务的格子都比它大.
+	 int64_t cursor_;
+
+	 // 每一层哪些槽位不是空的.
+	 uint64_t occupied_[kLevels];
+	 Node* slots_[kLevels][kSlotsPerLevel];
+	 Node* far_;
+
+	 // 格子不晚于|cursor_|的任务, 是一个堆.
+	 std::vector<Node*> due_;
+
+	 // 还没有运行也没有被取消的任务数量.
+	 std::size_t size_;
+
+	 void* free_nodes_;
+	 std::size_t free_node_count_;
+
+	 DISALLOW_COPY_AND_ASSIGN(TimingWheel);
+};
+
+}	// namespace internal.
+
+}	// namespace base.
+
+#endif // !BASE_MESSAGE_LOOP_TIMING_WHEEL_H
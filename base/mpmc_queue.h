@@ -0,0 +1,360 @@
+﻿/**
+* @Author: YangGuang
+* @Date:   2026-10-17
+* @Email:  guang334419520@126.com
+* @Filename: mpmc_queue.h
+* @Last modified by:  YangGuang
+*/
+
+#ifndef BASE_MPMC_QUEUE_H
+#define BASE_MPMC_QUEUE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#include "base/macor.h"
+
+namespace base {
+
+// 一个多生产者多消费者的无锁队列，和ThreadSafeQueue提供一样的Push/TryPop接口.
+//
+// 队列由若干个段(Segment)连成一个环, 每一个段是一个Dmitry Vyukov的有界MPMC环形
+// 队列: 每一个槽位都带有一个序列号, 生产者和消费者各自只需要一次CAS来抢占
+// enqueue/dequeue的位置, 之后只写自己的槽位, 没有任何锁.
+//
+// 生产者只往|tail_|段里面放, 消费者只从|head_|段里面取. |tail_|段满了以后把它
+// 关闭(在enqueue的位置上设置kClosedBit, 之后这个段不再接受新的元素), 然后换到下
+// 一个已经被取空的段, 如果下一个段就是|head_|(所有的段都在用), 就在中间插入一个
+// 新的段. |head_|段被关闭并且取空以后, 消费者换到下一个段. 只有换段的时候需要加锁,
+// 每|capacity|个元素最多一次, 所以积压很多的时候也不会退化成一个加锁的队列.
+//
+// 段在队列析构之前不会被释放, 只会被重复使用, 所以拿着一个旧的段指针的线程
+// 不会访问到释放了的内存: 关闭的段会拒绝新的元素, 重新打开的段一定是当前的
+// |tail_|. 段的数量等于积压最多的时候需要的段数. 每个段里面严格先进先出, 拿着旧的
+// 段指针的消费者可能会提前取到一个新的元素, 所以整体上是大致的先进先出.
+template <typename T>
+class MPMCQueue {
+ public:
+	 // |capacity|是每一个段的大小.
+	 explicit MPMCQueue(std::size_t capacity = 4096)
+		 : mask_(RoundUpToPowerOfTwo(capacity) - 1),
+		   segment_count_(1) {
+		 Segment* segment = new Segment(mask_);
+		 segment->next.store(segment, std::memory_order_relaxed);
+		 head_.store(segment, std::memory_order_relaxed);
+		 tail_.store(segment, std::memory_order_relaxed);
+	 }
+
+	 ~MPMCQueue() {
+		 Clear();
+		 Segment* first = head_.load(std::memory_order_relaxed);
+		 Segment* segment = first;
+		 do {
+			 Segment* next = segment->next.load(std::memory_order_relaxed);
+			 delete segment;
+			 segment = next;
+		 } while (segment != first);
+	 }
+
+	 // 可以在任意线程调用.
+	 void Push(T value) {
+		 if (tail_.load(std::memory_order_acquire)->TryPush(value))
+			 return;
+
+		 std::lock_guard<std::mutex> lock(segment_mutex_);
+		 // 等锁的时候别的生产者可能已经换过段了.
+		 while (!tail_.load(std::memory_order_relaxed)->TryPush(value))
+			 AdvanceTailLocked();
+	 }
+
+	 // 可以在任意线程调用. 一次加入|count|个元素, |values|里面的元素会被移走.
+	 // |tail_|段里面有足够的连续空位的时候只需要一次CAS.
+	 void PushBatch(T* values, std::size_t count) {
+		 if (count == 0)
+			 return;
+
+		 if (tail_.load(std::memory_order_acquire)->TryPushBatch(values, count))
+			 return;
+
+		 std::lock_guard<std::mutex> lock(segment_mutex_);
+		 Segment* tail = tail_.load(std::memory_order_relaxed);
+		 if (tail->TryPushBatch(values, count))
+			 return;
+		 for (std::size_t i = 0; i < count; ++i) {
+			 while (!tail_.load(std::memory_order_relaxed)->TryPush(values[i]))
+				 AdvanceTailLocked();
+		 }
+	 }
+
+	 // 可以在任意线程调用, 如果队列为空返回false.
+	 bool TryPop(T& value) {
+		 for (;;) {
+			 Segment* head = head_.load(std::memory_order_acquire);
+			 if (head->TryPop(value))
+				 return true;
+			 // 没有关闭的段一定是|tail_|, 队列是空的. 关闭了但是还没有取空, 说明
+			 // 有生产者抢到了位置但是还没有写完, 和一个段的时候一样当作空的.
+			 if (!head->IsDrained())
+				 return false;
+
+			 std::lock_guard<std::mutex> lock(segment_mutex_);
+			 // 关闭的段不会是|tail_|, 所以|head_|不会超过|tail_|.
+			 if (head_.load(std::memory_order_relaxed) == head)
+				 head_.store(head->next.load(std::memory_order_relaxed),
+							 std::memory_order_release);
+		 }
+	 }
+
+	 // 只是一个近似值，在并发的情况下只能作为提示使用.
+	 bool Empty() const {
+		 Segment* head = head_.load(std::memory_order_relaxed);
+		 return head == tail_.load(std::memory_order_relaxed) &&
+			 head->ApproximateSize() == 0;
+	 }
+
+	 // 只是一个近似值，在并发的情况下只能作为提示使用.
+	 std::size_t ApproximateSize() const {
+		 Segment* segment = head_.load(std::memory_order_acquire);
+		 Segment* tail = tail_.load(std::memory_order_acquire);
+		 std::size_t size = segment->ApproximateSize();
+		 // 段不会被释放, 最多走一圈.
+		 std::size_t segments = segment_count_.load(std::memory_order_relaxed);
+		 while (segment != tail && --segments > 0) {
+			 segment = segment->next.load(std::memory_order_acquire);
+			 size += segment->ApproximateSize();
+		 }
+		 return size;
+	 }
+
+	 // 删除队列中所有的元素.
+	 void Clear() {
+		 T value;
+		 while (TryPop(value)) {
+		 }
+	 }
+
+ private:
+	 struct Cell {
+		 std::atomic<std::size_t> sequence;
+		 typename std::aligned_storage<sizeof(T), alignof(T)>::type storage;
+	 };
+
+	 // enqueue的位置上的这一位表示这个段已经关闭, 不再接受新的元素.
+	 static constexpr std::size_t kClosedBit =
+		 std::size_t(1) << (sizeof(std::size_t) * 8 - 1);
+
+	 class Segment {
+	  public:
+		  explicit Segment(std::size_t mask)
+			  : mask_(mask),
+			    cells_(new Cell[mask + 1]),
+			    next(nullptr) {
+			  for (std::size_t i = 0; i <= mask_; ++i)
+				  cells_[i].sequence.store(i, std::memory_order_relaxed);
+			  enqueue_pos_.store(0, std::memory_order_relaxed);
+			  dequeue_pos_.store(0, std::memory_order_relaxed);
+		  }
+
+		  // 段满了或者已经关闭的时候返回false, 这时候|value|没有被移走.
+		  bool TryPush(T& value) {
+			  Cell* cell;
+			  std::size_t pos = enqueue_pos_.load(std::memory_order_relaxed);
+			  for (;;) {
+				  if (pos & kClosedBit)
+					  return false;
+				  cell = &cells_[pos & mask_];
+				  const std::size_t seq =
+					  cell->sequence.load(std::memory_order_acquire);
+				  const intptr_t diff =
+					  static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+				  if (diff == 0) {
+					  if (enqueue_pos_.compare_exchange_weak(
+							  pos, pos + 1, std::memory_order_relaxed)) {
+						  break;
+					  }
+				  }
+				  else if (diff < 0) {
+					  // 段已经满了.
+					  return false;
+				  }
+				  else {
+					  pos = enqueue_pos_.load(std::memory_order_relaxed);
+				  }
+			  }
+
+			  new (&cell->storage) T(std::move(value));
+			  cell->sequence.store(pos + 1, std::memory_order_release);
+			  return true;
+		  }
+
+		  // 一次CAS占用[pos, pos + count)这一段位置. 只有这一段的每一个槽位都已经
+		  // 被消费者释放的时候才会成功, 失败的时候什么都不做.
+		  bool TryPushBatch(T* values, std::size_t count) {
+			  if (count > mask_ + 1)
+				  return false;
+
+			  std::size_t pos = enqueue_pos_.load(std::memory_order_relaxed);
+			  for (;;) {
+				  if (pos & kClosedBit)
+					  return false;
+				  bool ready = true;
+				  for (std::size_t i = 0; i < count; ++i) {
+					  const std::size_t seq = cells_[(pos + i) & mask_].sequence.load(
+						  std::memory_order_acquire);
+					  if (seq != pos + i) {
+						  ready = false;
+						  break;
+					  }
+				  }
+				  if (!ready) {
+					  const std::size_t current =
+						  enqueue_pos_.load(std::memory_order_relaxed);
+					  // 位置没有变，说明是段里面没有足够的空位.
+					  if (current == pos)
+						  return false;
+					  pos = current;
+					  continue;
+				  }
+				  if (enqueue_pos_.compare_exchange_weak(
+						  pos, pos + count, std::memory_order_relaxed)) {
+					  break;
+				  }
+			  }
+
+			  for (std::size_t i = 0; i < count; ++i) {
+				  Cell* cell = &cells_[(pos + i) & mask_];
+				  new (&cell->storage) T(std::move(values[i]));
+				  cell->sequence.store(pos + i + 1, std::memory_order_release);
+			  }
+			  return true;
+		  }
+
+		  bool TryPop(T& value) {
+			  Cell* cell;
+			  std::size_t pos = dequeue_pos_.load(std::memory_order_relaxed);
+			  for (;;) {
+				  cell = &cells_[pos & mask_];
+				  const std::size_t seq =
+					  cell->sequence.load(std::memory_order_acquire);
+				  const intptr_t diff =
+					  static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos + 1);
+				  if (diff == 0) {
+					  if (dequeue_pos_.compare_exchange_weak(
+							  pos, pos + 1, std::memory_order_relaxed)) {
+						  break;
+					  }
+				  }
+				  else if (diff < 0) {
+					  // 段是空的.
+					  return false;
+				  }
+				  else {
+					  pos = dequeue_pos_.load(std::memory_order_relaxed);
+				  }
+			  }
+
+			  T* slot = reinterpret_cast<T*>(&cell->storage);
+			  value = std::move(*slot);
+			  slot->~T();
+			  cell->sequence.store(pos + mask_ + 1, std::memory_order_release);
+			  return true;
+		  }
+
+		  // 只能在|segment_mutex_|里面调用. 之后所有的TryPush()都会失败.
+		  void Close() {
+			  enqueue_pos_.fetch_or(kClosedBit, std::memory_order_relaxed);
+		  }
+
+		  // 只能在|segment_mutex_|里面调用, 段必须已经被取空. 序列号已经是下一圈
+		  // 需要的值了, 所以只需要去掉kClosedBit.
+		  void Reopen() {
+			  enqueue_pos_.store(
+				  enqueue_pos_.load(std::memory_order_relaxed) & ~kClosedBit,
+				  std::memory_order_relaxed);
+		  }
+
+		  // 已经关闭并且所有的位置都被消费者抢到了.
+		  bool IsDrained() const {
+			  const std::size_t enqueue_pos =
+				  enqueue_pos_.load(std::memory_order_acquire);
+			  return (enqueue_pos & kClosedBit) &&
+				  (enqueue_pos & ~kClosedBit) ==
+					  dequeue_pos_.load(std::memory_order_acquire);
+		  }
+
+		  std::size_t ApproximateSize() const {
+			  const std::size_t enqueue_pos =
+				  enqueue_pos_.load(std::memory_order_relaxed) & ~kClosedBit;
+			  const std::size_t dequeue_pos =
+				  dequeue_pos_.load(std::memory_order_relaxed);
+			  return enqueue_pos > dequeue_pos ? enqueue_pos - dequeue_pos : 0;
+		  }
+
+	  private:
+		  const std::size_t mask_;
+		  const std::unique_ptr<Cell[]> cells_;
+
+		  // 生产者和消费者分别写这两个位置，放在不同的cache line上.
+		  alignas(64) std::atomic<std::size_t> enqueue_pos_;
+		  alignas(64) std::atomic<std::size_t> dequeue_pos_;
+
+	  public:
+		  // 环上的下一个段, 只在|segment_mutex_|里面修改.
+		  std::atomic<Segment*> next;
+
+		  DISALLOW_COPY_AND_ASSIGN(Segment);
+	 };
+
+	 static std::size_t RoundUpToPowerOfTwo(std::size_t value) {
+		 std::size_t result = 2;
+		 while (result < value)
+			 result <<= 1;
+		 return result;
+	 }
+
+	 // 关闭|tail_|段, 换到下一个空闲的段, 没有空闲的段就插入一个新的.
+	 // |head_|到|tail_|之间的段都是关闭的并且可能还有元素, |tail_|之后到|head_|
+	 // 之前的段都是关闭的并且已经取空了.
+	 void AdvanceTailLocked() {
+		 Segment* tail = tail_.load(std::memory_order_relaxed);
+		 tail->Close();
+
+		 Segment* next = tail->next.load(std::memory_order_relaxed);
+		 if (next == head_.load(std::memory_order_relaxed)) {
+			 Segment* segment = new Segment(mask_);
+			 segment->next.store(next, std::memory_order_relaxed);
+			 tail->next.store(segment, std::memory_order_release);
+			 next = segment;
+			 segment_count_.fetch_add(1, std::memory_order_relaxed);
+		 }
+		 else {
+			 next->Reopen();
+		 }
+		 tail_.store(next, std::memory_order_release);
+	 }
+
+	 const std::size_t mask_;
+
+	 // 消费者和生产者分别读这两个指针, 只在|segment_mutex_|里面修改.
+	 alignas(64) std::atomic<Segment*> head_;
+	 alignas(64) std::atomic<Segment*> tail_;
+
+	 std::atomic<std::size_t> segment_count_;
+	 std::mutex segment_mutex_;
+
+	 DISALLOW_COPY_AND_ASSIGN(MPMCQueue);
+};
+
+template <typename T>
+constexpr std::size_t MPMCQueue<T>::kClosedBit;
+
+}	// namespace base.
+
+#endif // !BASE_MPMC_QUEUE_H
@@ -0,0 +1,206 @@
+﻿/**
+* @Author: YangGuang
+* @Date:   2026-10-17
+* @Email:  guang334419520@126.com
+* @Filename: mpsc_queue.h
+* @Last modified by:  YangGuang
+*/
+
+#ifndef BASE_MPSC_QUEUE_H
+#define BASE_MPSC_QUEUE_H
+
+#include <stddef.h>
+
+#include <atomic>
+#include <new>
+#include <utility>
+
+#include "base/logging.h"
+#include "base/macor.h"
+
+namespace base {
+
+// 一个多生产者单消费者的无锁队列(Dmitry Vyukov的intrusive MPSC node-based
+// queue). 每一个元素放在一个节点里面, 节点之间通过|next|指针连接.
+//
+// 生产者Push()只需要一次原子exchange抢到队尾, 然后把前一个节点的|next|指向
+// 自己, 没有CAS循环也没有锁, 生产者之间不会互相等待. 消费者只能有一个, 只需要
+// 顺着|next|读取, 不和生产者竞争.
+//
+// 生产者exchange之后、链接|next|之前被打断的话，消费者会暂时看不到这个元素以及
+// 之后的元素, TryPop()返回false, 等生产者链接完成以后就能看到. 所以TryPop()
+// 返回false不代表队列一定是空的, 需要调用者自己保证之后会再来取(比如生产者在
+// Push()之后唤醒消费者).
+//
+// 取出的元素的节点由消费者缓存起来(最多kMaxFreeNodes个), 消费者自己Push的时候
+// 使用PushFromConsumer()可以复用它们, 不需要分配内存. 其他线程Push()的时候还是
+// 分配新的节点.
+template <typename T>
+class MPSCQueue {
+ public:
+	 MPSCQueue()
+		 : head_(&stub_),
+		   front_(nullptr),
+		   free_nodes_(nullptr),
+		   free_node_count_(0),
+		   tail_(&stub_) {
+		 stub_.next.store(nullptr, std::memory_order_relaxed);
+	 }
+
+	 // 只能在没有生产者的时候析构.
+	 ~MPSCQueue() {
+		 if (front_)
+			 DeleteNode(front_);
+		 while (ValueNode* node = PopNode())
+			 DeleteNode(node);
+		 while (free_nodes_) {
+			 Node* next = free_nodes_->next.load(std::memory_order_relaxed);
+			 ::operator delete(free_nodes_);
+			 free_nodes_ = next;
+		 }
+	 }
+
+	 // 可以在任意线程调用.
+	 void Push(T value) {
+		 void* memory = ::operator new(sizeof(ValueNode));
+		 Link(new (memory) ValueNode(std::move(value)));
+	 }
+
+	 // 和Push()一样, 但是只能在消费者线程调用, 优先复用缓存的节点.
+	 void PushFromConsumer(T value) {
+		 void* memory;
+		 if (free_nodes_) {
+			 memory = free_nodes_;
+			 free_nodes_ = free_nodes_->next.load(std::memory_order_relaxed);
+			 --free_node_count_;
+		 }
+		 else {
+			 memory = ::operator new(sizeof(ValueNode));
+		 }
+		 Link(new (memory) ValueNode(std::move(value)));
+	 }
+
+	 // 只能在消费者线程调用. 返回队头的元素但是不取出来, 现在看不到元素的时候返回
+	 // nullptr. 调用者可以直接修改或者移走这个元素, 然后用Pop()删除它.
+	 T* Peek() {
+		 if (!front_)
+			 front_ = PopNode();
+		 return front_ ? &front_->value : nullptr;
+	 }
+
+	 // 只能在消费者线程调用. 删除Peek()返回的元素.
+	 void Pop() {
+		 DCHECK(front_);
+		 DeleteNode(front_);
+		 front_ = nullptr;
+	 }
+
+	 // 只能在消费者线程调用.
+	 bool TryPop(T* value) {
+		 T* front = Peek();
+		 if (!front)
+			 return false;
+		 *value = std::move(*front);
+		 Pop();
+		 return true;
+	 }
+
+	 // 只能在消费者线程调用. 按照先进先出的顺序把现在能看到的元素都交给
+	 // |consumer|(T&&), 返回元素的个数. 不要求T可以默认构造.
+	 template <typename Consumer>
+	 std::size_t PopAll(Consumer consumer) {
+		 std::size_t count = 0;
+		 while (T* front = Peek()) {
+			 consumer(std::move(*front));
+			 Pop();
+			 ++count;
+		 }
+		 return count;
+	 }
+
+	 // 只能在消费者线程调用. 和TryPop()一样，可能把正在Push的元素当作不存在.
+	 bool Empty() const {
+		 return !front_ && head_ == &stub_ &&
+			 stub_.next.load(std::memory_order_seq_cst) == nullptr;
+	 }
+
+ private:
+	 struct Node {
+		 std::atomic<Node*> next;
+	 };
+
+	 struct ValueNode : public Node {
+		 explicit ValueNode(T value) : value(std::move(value)) {}
+		 T value;
+	 };
+
+	 // 最多缓存的空闲节点数量.
+	 static constexpr std::size_t kMaxFreeNodes = 256;
+
+	 void Link(ValueNode* node) {
+		 node->next.store(nullptr, std::memory_order_relaxed);
+		 Node* prev = tail_.exchange(node, std::memory_order_acq_rel);
+		 // seq_cst: 调用者可以在这之后用seq_cst的原子操作和消费者同步, 保证消费者
+		 // 在那之后一定能看到这个元素.
+		 prev->next.store(node, std::memory_order_seq_cst);
+	 }
+
+	 // 只能在消费者线程调用. |node|已经不在队列里面了.
+	 void DeleteNode(ValueNode* node) {
+		 node->~ValueNode();
+		 if (free_node_count_ < kMaxFreeNodes) {
+			 Node* free_node = new (node) Node;
+			 free_node->next.store(free_nodes_, std::memory_order_relaxed);
+			 free_nodes_ = free_node;
+			 ++free_node_count_;
+		 }
+		 else {
+			 ::operator delete(node);
+		 }
+	 }
+
+	 // 取出队头的节点, 没有的话返回nullptr.
+	 ValueNode* PopNode() {
+		 Node* head = head_;
+		 Node* next = head->next.load(std::memory_order_seq_cst);
+		 if (head == &stub_) {
+			 if (!next)
+				 return nullptr;
+			 head_ = next;
+			 head = next;
+			 next = next->next.load(std::memory_order_seq_cst);
+		 }
+
+		 if (!next) {
+			 // |head|是最后一个节点, 或者有生产者正在链接后面的节点.
+			 if (head != tail_.load(std::memory_order_seq_cst))
+				 return nullptr;
+			 // 把stub放回队尾，这样|head|就有后继, 可以被取出来.
+			 stub_.next.store(nullptr, std::memory_order_relaxed);
+			 Node* prev = tail_.exchange(&stub_, std::memory_order_acq_rel);
+			 prev->next.store(&stub_, std::memory_order_seq_cst);
+			 next = head->next.load(std::memory_order_seq_cst);
+			 if (!next)
+				 return nullptr;
+		 }
+
+		 head_ = next;
+		 return static_cast<ValueNode*>(head);
+	 }
+
+	 // 只有消费者访问.
+	 Node* head_;
+	 // Peek()已经取出来但是还没有Pop()的节点.
+	 ValueNode* front_;
+	 Node* free_nodes_;
+	 std::size_t free_node_count_;
+	 // 所有的生产者都exchange这个指针, 和|head_|放在不同的cache line上.
+	 alignas(64) std::atomic<Node*> tail_;
+	 Node stub_;
+
+	 DISALLOW_COPY_AND_ASSIGN(MPSCQueue);
+};
+
+}	// namespace base.
+
+#endif // !BASE_MPSC_QUEUE_H
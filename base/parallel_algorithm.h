@@ -0,0 +1,296 @@
+﻿/**
+* @Author: YangGuang
+* @Date:   2026-10-17
+* @Email:  guang334419520@126.com
+* @Filename: parallel_algorithm.h
+* @Last modified by:  YangGuang
+*/
+
+// 基于ThreadPool的数据并行算法: ParallelFor, ParallelReduce, ParallelTransform
+// 和 ParallelSort.
+//
+// 所有的算法都是递归的把区间一分为二，把右半边作为一个任务提交给线程池(在工作
+// 线程上调用的时候会进入自己的work-stealing队列，空闲的线程会把它偷走), 自己继续
+// 处理左半边, 直到区间小于grain size. 如果之前分出去的任务还没有被偷走，就不再
+// 继续切分(lazy binary splitting), 所以grain size会随着线程的繁忙程度自动调整.
+// 调用线程等待的时候不会阻塞，而是通过ThreadPool::RunPendingTask()一起执行线程池
+// 里面的任务.
+//
+// Sample usage:
+//   base::ParallelFor(pool, 0, static_cast<int>(v.size()),
+//                     [&](int i) { v[i] = Compute(i); });
+//
+//   int64_t sum = base::ParallelReduce(
+//       pool, 0, n, int64_t(0),
+//       [&](int i) { return int64_t(v[i]); },
+//       [](int64_t a, int64_t b) { return a + b; });
+//
+// 如果|pool|为nullptr, 所有的算法都会在调用线程上串行执行.
+
+#ifndef BASE_PARALLEL_ALGORITHM_H
+#define BASE_PARALLEL_ALGORITHM_H
+
+#include <stddef.h>
+
+#include <algorithm>
+#include <exception>
+#include <functional>
+#include <iterator>
+#include <mutex>
+#include <vector>
+
+#include "base/macor.h"
+#include "base/task/helping_wait.h"
+#include "base/thread_pool.h"
+
+namespace base {
+
+namespace internal {
+
+// 记录还没有完成的子任务数量, 等待的线程会帮助线程池执行任务，直到计数为0
+// (见HelpingWait()). 子任务抛出的第一个异常会在Wait()里面重新抛出.
+class ParallelJoinCounter {
+ public:
+	 ParallelJoinCounter() {}
+
+	 void Increment() { pending_.Add(1); }
+
+	 // 子任务对这个计数的最后一次访问, 之后等待的线程可能已经把它释放了.
+	 void Decrement() { pending_.Done(); }
+
+	 void SetException(std::exception_ptr exception) {
+		 std::lock_guard<std::mutex> lock(exception_lock_);
+		 if (!exception_)
+			 exception_ = exception;
+	 }
+
+	 // 只能调用一次.
+	 void Wait(ThreadPool* pool) {
+		 pending_.Wait(pool);
+
+		 if (exception_)
+			 std::rethrow_exception(exception_);
+	 }
+
+ private:
+	 JoinCount pending_;
+	 std::mutex exception_lock_;
+	 std::exception_ptr exception_;
+
+	 DISALLOW_COPY_AND_ASSIGN(ParallelJoinCounter);
+};
+
+// 没有指定grain size的时候，让每一个线程大约分到8块, 这样偷取可以平衡负载,
+// 又不会因为任务太多带来额外的开销.
+inline std::size_t DefaultGrainSize(ThreadPool* pool, std::size_t count) {
+	const std::size_t chunks = pool->thread_num() * 8;
+	return std::max<std::size_t>(1, count / std::max<std::size_t>(1, chunks));
+}
+
+// ParallelReduce()每一块的结果. 每一个占一整条cache line, 不同的块同时写自己的
+// 结果的时候不会互相干扰, 也避开了std::vector<bool>把多个元素放在同一个字里面.
+template <typename T>
+struct alignas(64) ParallelReducePartial {
+	T value;
+};
+
+// 对[begin, end)递归二分, 每一个不大于|grain|的块调用|body|(chunk_begin,
+// chunk_end).
+template <typename Index, typename RangeBody>
+void ParallelForRange(ThreadPool* pool,
+					  Index begin,
+					  Index end,
+					  std::size_t grain,
+					  const RangeBody* body,
+					  ParallelJoinCounter* join) {
+	while (static_cast<std::size_t>(end - begin) > grain) {
+		// Lazy binary splitting: 上一次分出去的任务还没有被别的线程偷走, 说明其他
+		// 线程都很忙, 继续切分只会增加开销，所以先自己处理一块.
+		if (!pool->LocalQueueIsEmpty()) {
+			const Index next = begin + static_cast<Index>(grain);
+			(*body)(begin, next);
+			begin = next;
+			continue;
+		}
+
+		const Index mid = begin + (end - begin) / 2;
+		join->Increment();
+		pool->PostTask([pool, mid, end, grain, body, join]() {
+			try {
+				ParallelForRange(pool, mid, end, grain, body, join);
+			}
+			catch (...) {
+				join->SetException(std::current_exception());
+			}
+			join->Decrement();
+		});
+		end = mid;
+	}
+	(*body)(begin, end);
+}
+
+template <typename Index, typename RangeBody>
+void ParallelForEachRange(ThreadPool* pool,
+						  Index begin,
+						  Index end,
+						  std::size_t grain,
+						  const RangeBody& body) {
+	if (end <= begin)
+		return;
+
+	const std::size_t count = static_cast<std::size_t>(end - begin);
+	if (!pool) {
+		body(begin, end);
+		return;
+	}
+	if (grain == 0)
+		grain = DefaultGrainSize(pool, count);
+
+	ParallelJoinCounter join;
+	try {
+		ParallelForRange(pool, begin, end, grain, &body, &join);
+	}
+	catch (...) {
+		join.SetException(std::current_exception());
+	}
+	join.Wait(pool);
+}
+
+template <typename RandomIt, typename Compare>
+void ParallelMergeSort(ThreadPool* pool,
+					   RandomIt first,
+					   RandomIt last,
+					   std::size_t grain,
+					   const Compare* comp) {
+	const std::size_t count = static_cast<std::size_t>(last - first);
+	if (count <= grain) {
+		std::sort(first, last, *comp);
+		return;
+	}
+
+	RandomIt middle = first + count / 2;
+	ParallelJoinCounter join;
+	join.Increment();
+	pool->PostTask([pool, middle, last, grain, comp, &join]() {
+		try {
+			ParallelMergeSort(pool, middle, last, grain, comp);
+		}
+		catch (...) {
+			join.SetException(std::current_exception());
+		}
+		join.Decrement();
+	});
+
+	try {
+		ParallelMergeSort(pool, first, middle, grain, comp);
+	}
+	catch (...) {
+		join.SetException(std::current_exception());
+	}
+	// 必须等右半边结束以后才能离开, 因为它引用了栈上的|join|.
+	join.Wait(pool);
+	std::inplace_merge(first, middle, last, *comp);
+}
+
+}	// namespace internal.
+
+// 对[begin, end)里面的每一个下标i调用|body|(i). |grain|为0的时候会根据元素
+// 数量和线程数自动选择.
+template <typename Index, typename Body>
+void ParallelFor(ThreadPool* pool,
+				 Index begin,
+				 Index end,
+				 const Body& body,
+				 std::size_t grain = 0) {
+	internal::ParallelForEachRange(
+		pool, begin, end, grain,
+		[&body](Index chunk_begin, Index chunk_end) {
+			for (Index i = chunk_begin; i != chunk_end; ++i)
+				body(i);
+		});
+}
+
+// 计算 reduce(map(begin), map(begin + 1), ..., map(end - 1)).
+// |reduce|必须满足结合律, |identity|是它的单位元.
+template <typename Index, typename T, typename Map, typename Reduce>
+T ParallelReduce(ThreadPool* pool,
+				 Index begin,
+				 Index end,
+				 T identity,
+				 const Map& map,
+				 const Reduce& reduce,
+				 std::size_t grain = 0) {
+	if (end <= begin)
+		return identity;
+
+	const std::size_t count = static_cast<std::size_t>(end - begin);
+	if (grain == 0)
+		grain = pool ? internal::DefaultGrainSize(pool, count) : count;
+
+	// 每一块的结果写到自己的位置，最后在调用线程上合并. 块的数量只和线程数有关，
+	// 所以最后的串行合并很便宜.
+	const std::size_t chunks = (count + grain - 1) / grain;
+	std::vector<internal::ParallelReducePartial<T>> partials(
+		chunks, internal::ParallelReducePartial<T>{identity});
+	ParallelFor(pool, std::size_t(0), chunks, [&](std::size_t chunk) {
+		const Index chunk_begin = begin + static_cast<Index>(chunk * grain);
+		const Index chunk_end =
+			begin + static_cast<Index>(std::min(count, (chunk + 1) * grain));
+		T value = identity;
+		for (Index i = chunk_begin; i != chunk_end; ++i)
+			value = reduce(value, map(i));
+		partials[chunk].value = std::move(value);
+	}, 1);
+
+	T result = identity;
+	for (auto& partial : partials)
+		result = reduce(result, partial.value);
+	return result;
+}
+
+// 和std::transform一样, 但是并行执行, 迭代器必须是随机访问的.
+template <typename InputIt, typename OutputIt, typename UnaryOperation>
+OutputIt ParallelTransform(ThreadPool* pool,
+						   InputIt first,
+						   InputIt last,
+						   OutputIt d_first,
+						   const UnaryOperation& op,
+						   std::size_t grain = 0) {
+	const auto count = last - first;
+	internal::ParallelForEachRange(
+		pool, decltype(count)(0), count, grain,
+		[&](decltype(count) chunk_begin, decltype(count) chunk_end) {
+			std::transform(first + chunk_begin, first + chunk_end,
+						   d_first + chunk_begin, op);
+		});
+	return d_first + count;
+}
+
+// 并行归并排序, 两半并行的排序，然后合并. 不是稳定排序.
+template <typename RandomIt, typename Compare>
+void ParallelSort(ThreadPool* pool,
+				  RandomIt first,
+				  RandomIt last,
+				  const Compare& comp,
+				  std::size_t grain = 0) {
+	const std::size_t count = static_cast<std::size_t>(last - first);
+	if (!pool || count < 2) {
+		std::sort(first, last, comp);
+		return;
+	}
+	if (grain == 0)
+		grain = std::max<std::size_t>(internal::DefaultGrainSize(pool, count),
+									  1024);
+
+	internal::ParallelMergeSort(pool, first, last, grain, &comp);
+}
+
+template <typename RandomIt>
+void ParallelSort(ThreadPool* pool, RandomIt first, RandomIt last) {
+	using value_type = typename std::iterator_traits<RandomIt>::value_type;
+	ParallelSort(pool, first, last, std::less<value_type>());
+}
+
+}	// namespace base.
+
+#endif // !BASE_PARALLEL_ALGORITHM_H
@@ -11,16 +11,39 @@
 #include "base/message_loop/message_loop.h"
 
 namespace base {
+
+namespace internal {
+
+std::size_t PendingTaskSizeInBase() {
+	return sizeof(PendingTask);
+}
+
+}	// namespace internal.
+
+const char* TaskQueuePriorityToString(TaskQueuePriority priority) {
+	switch (priority) {
+	case TaskQueuePriority::kHigh:
+		return "high";
+	case TaskQueuePriority::kNormal:
+		return "normal";
+	case TaskQueuePriority::kBestEffort:
+		return "best_effort";
+	}
+	return "unknown";
+}
+
 PendingTask::PendingTask(const Location & posted_from,
 						 OnceClosure task, 
-						 std::chrono::milliseconds delayed_run_time,
+						 TimeTicks delayed_run_time,
 						 Nestable nestable)
 	: task(std::move(task)),
 	  posted_from(posted_from),
 	  delayed_run_time(delayed_run_time),
 	  sequence_num(0),
 	  nestable(nestable),
+	  priority(TaskQueuePriority::kNormal),
 	  is_high_res(false) {
+#if ENABLE_TASK_BACKTRACE
 	const PendingTask* parent_task =
 		MessageLoop::current() ? MessageLoop::current()->current_pending_task_
 		: nullptr;
@@ -33,6 +56,7 @@ PendingTask::PendingTask(const Location & posted_from,
 	else {
 		task_backtrace.fill(nullptr);
 	}
+#endif
 }
 
 PendingTask::PendingTask(PendingTask && other) = default;
@@ -8,27 +8,84 @@
 #ifndef BASE_PENDING_TASK_H
 #define BASE_PENDING_TASK_H
 
+#include <stddef.h>
+#include <stdint.h>
+
 #include <array>
+#include <memory>
 #include <queue>
-#include <chrono>
 
 #include "base/base_export.h"
 #include "base/callback.h"
 #include "base/location.h"
+#include "base/time/time.h"
 
 //using namespace std;
 
 namespace base {
 
-enum class Nestable {
+namespace internal {
+
+class IncomingTaskQueue;
+struct TimingWheelNode;
+
+// PostCancelableDelayedTask()提交的任务和它的DelayedTaskHandle共享的状态, 只能在
+// 任务所在的序列上访问. 任务在延迟队列里面的时候记录它的位置, 这样取消的时候可以
+// 直接把它删掉, 而不是等到它的运行时间.
+struct CancelableTaskState {
+	// 任务开始运行、被取消或者被丢弃以后为false.
+	bool pending = true;
+
+	// 任务在这个队列的延迟队列里面的时候不为null.
+	IncomingTaskQueue* queue = nullptr;
+
+	// 任务在延迟队列的二叉堆里面的下标.
+	std::size_t heap_index = 0;
+
+	// 任务在延迟队列的时间轮里面的时候不为null.
+	TimingWheelNode* wheel_node = nullptr;
+};
+
+}	// namespace internal.
+
+// 为1的时候每个任务会记下提交它的那几层任务的位置(task_backtrace), 调试的时候
+// 可以看到任务是怎么来的, 但是每个任务多32个字节, 提交的时候也要多读一次TLS.
+// 默认关闭.
+//
+// 它会改变PendingTask的布局, 所以只能由构建系统给base和所有使用base的代码统一
+// 定义(例如 -DENABLE_TASK_BACKTRACE=1), 不能跟着NDEBUG变, 也不能在某一个文件里面
+// 单独定义. 两边不一致的时候MessageLoop::TaskObserver的构造函数会CHECK失败.
+#if !defined(ENABLE_TASK_BACKTRACE)
+#define ENABLE_TASK_BACKTRACE 0
+#endif
+
+enum class Nestable : uint8_t {
 	kNonNestable,
 	kNestable,
 };
 
+// 一个MessageLoop上面有几个不同优先级的任务队列, 每个队列有自己的
+// SingleThreadTaskRunner, 见MessageLoop::task_runner(TaskQueuePriority).
+enum class TaskQueuePriority : uint8_t {
+	// 对延迟敏感的任务, 例如输入事件和心跳.
+	kHigh,
+	// MessageLoop::task_runner()提交的任务.
+	kNormal,
+	// 可以随便推迟的后台任务.
+	kBestEffort,
+};
+
+constexpr int kTaskQueuePriorityCount = 3;
+
+// 返回队列的名字, 例如"high".
+BASE_EXPORT const char* TaskQueuePriorityToString(TaskQueuePriority priority);
+
+// 每提交一个任务都要构造一个PendingTask, 然后在几个队列之间移动, 所以成员按照
+// 大小排列, 不要随便加新的成员. 关闭ENABLE_TASK_BACKTRACE的时候是104个字节.
 struct BASE_EXPORT PendingTask {
 	PendingTask(const Location& posted_from,
 				OnceClosure task,
-				std::chrono::milliseconds delayed_run_time = std::chrono::milliseconds(0),
+				TimeTicks delayed_run_time = TimeTicks(),
 				Nestable nestable = Nestable::kNestable);
 	PendingTask(PendingTask&& other);
 	~PendingTask();
@@ -38,24 +95,46 @@ struct BASE_EXPORT PendingTask {
 	// Used to support sorting.
 	bool operator<(const PendingTask& other) const;
 
+	// 通过DelayedTaskHandle取消了的任务不应该再运行.
+	bool is_cancelled() const { return cancel_state && !cancel_state->pending; }
+
 	OnceClosure task;
 	
 	Location posted_from;
 
-	std::chrono::milliseconds delayed_run_time;
+	// 任务应该运行的时间点, null表示不是延迟任务.
+	TimeTicks delayed_run_time;
 
+	// 任务提交的时间, 只有打开了TaskTimingStats才会记录, 否则是null.
+	TimeTicks queue_time;
+
+	// 只有PostCancelableDelayedTask()提交的任务才有.
+	std::shared_ptr<internal::CancelableTaskState> cancel_state;
+
+#if ENABLE_TASK_BACKTRACE
 	std::array<const void*, 4> task_backtrace;
+#endif
 
 	int sequence_num;
 
 	Nestable nestable;
 
+	// 任务是通过哪一个优先级的队列提交的.
+	TaskQueuePriority priority;
+
+	// 延迟很短的任务需要高分辨率的计时器, 见IncomingTaskQueue.
 	bool is_high_res;
 };
 
 using TaskQueue = std::queue<PendingTask>;
 
-using DelayedTaskQueue = std::priority_queue<PendingTask>;
+namespace internal {
+
+// 返回编译base的时候的sizeof(PendingTask). 在base外面展开的代码用它和自己看到的
+// sizeof(PendingTask)比较, 就能发现ENABLE_TASK_BACKTRACE不一致.
+BASE_EXPORT std::size_t PendingTaskSizeInBase();
+
+}	// namespace internal.
 
 }		// namespace base.
 
@@ -14,10 +14,59 @@
 
 namespace base {
 
+namespace {
+
+// 默认的PostCancelableDelayedTask()使用的共享状态.
+struct CancelableTask {
+	explicit CancelableTask(OnceClosure task) : task(std::move(task)) {}
+
+	bool pending = true;
+	OnceClosure task;
+};
+
+void RunCancelableTask(const std::shared_ptr<CancelableTask>& cancelable_task) {
+	if (!cancelable_task->pending)
+		return;
+	cancelable_task->pending = false;
+	std::move(cancelable_task->task).Run();
+}
+
+class CancelableTaskDelegate : public DelayedTaskHandle::Delegate {
+ public:
+	 explicit CancelableTaskDelegate(std::shared_ptr<CancelableTask> task)
+		 : task_(std::move(task)) {}
+
+	 bool IsValid() const OVERRIDE { return task_->pending; }
+
+	 void CancelTask() OVERRIDE {
+		 task_->pending = false;
+		 task_->task.Reset();
+	 }
+
+ private:
+	 std::shared_ptr<CancelableTask> task_;
+};
+
+}	// namespace .
+
 bool SequencedTaskRunner::PostNonNestableTask(const Location & from_here,
 											  OnceClosure task) {
-	return PostNonNestableDelayedTask(from_here, std::move(task),
-									  std::chrono::milliseconds(0));
+	return PostNonNestableDelayedTask(from_here, std::move(task), TimeDelta());
+}
+
+DelayedTaskHandle SequencedTaskRunner::PostCancelableDelayedTask(
+	const Location& from_here,
+	OnceClosure task,
+	TimeDelta delay) {
+	auto cancelable_task = std::make_shared<CancelableTask>(std::move(task));
+	if (!PostDelayedTask(from_here,
+						 base::BindOnceClosure(&RunCancelableTask,
+											   cancelable_task),
+						 delay)) {
+		return DelayedTaskHandle();
+	}
+	return DelayedTaskHandle(
+		std::make_unique<CancelableTaskDelegate>(std::move(cancelable_task)));
 }
 
 SequencedTaskRunner::~SequencedTaskRunner() = default;
@@ -12,6 +12,7 @@
 
 #include "base/base_export.h"
 #include "base/macor.h"
+#include "base/task/delayed_task_handle.h"
 #include "base/task_runner.h"
 #include "base/sequenced_task_runner_helpers.h"
 
@@ -55,7 +56,17 @@ class BASE_EXPORT SequencedTaskRunner : public TaskRunner {
 
 	 virtual bool PostNonNestableDelayedTask(const Location& from_here,
 											 OnceClosure task,
-											 std::chrono::milliseconds delay) = 0;
+											 TimeDelta delay) = 0;
+
+	 // 和PostDelayedTask()一样, 但是返回一个可以取消这个任务的句柄. 提交失败的
+	 // 时候返回的句柄是无效的. 句柄只能在这个序列上使用.
+	 //
+	 // 默认的实现只是让取消了的任务在运行的时候什么都不做, 任务还是会留在队列
+	 // 里面直到它的运行时间. MessageLoop的实现会马上把任务从延迟队列里面删除
+	 // (O(log n)), 所以频繁的取消和重新提交不会让延迟队列变大.
+	 virtual DelayedTaskHandle PostCancelableDelayedTask(const Location& from_here,
+														 OnceClosure task,
+														 TimeDelta delay);
 
 	 // 提交一个non-nestable task来删除一个给定的对象, 如果返回true，
 	 // 那么这个对象可能在之后被删除，如果返回false，那么这个对象肯定
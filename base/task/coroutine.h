@@ -0,0 +1,364 @@
+﻿/**
+* @Author: YangGuang
+* @Date:   2026-10-17
+* @Email:  guang334419520@126.com
+* @Filename: coroutine.h
+* @Last modified by:  YangGuang
+*/
+#ifndef BASE_TASK_COROUTINE_H
+#define BASE_TASK_COROUTINE_H
+
+// C++20 协程支持, 只有在编译器支持协程的时候才可用.
+//
+// Sample usage:
+//   base::CoTask<void> HandleRequest(std::shared_ptr<Request> request) {
+//     // 切换到线程池上解析.
+//     co_await pool->Schedule();
+//     auto parsed = Parse(*request);
+//
+//     // 回到UI线程上更新.
+//     co_await ui_task_runner->Schedule();
+//     UpdateView(parsed);
+//
+//     // 1s以后在UI线程上继续.
+//     co_await ui_task_runner->ScheduleAfter(std::chrono::seconds(1));
+//     HideView();
+//   }
+//
+//   HandleRequest(request).Detach();
+//
+// 和PostTaskAndReply()相比，每一次切换线程只需要post一个只捕获了协程句柄的
+// 闭包, 不需要relay对象. 协程帧本身从一个thread_local的缓存里分配.
+
+#if defined(__cpp_impl_coroutine)
+
+#include <stddef.h>
+
+#include <chrono>
+#include <coroutine>
+#include <exception>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#include "base/callback.h"
+#include "base/location.h"
+#include "base/logging.h"
+#include "base/macor.h"
+#include "base/task_runner.h"
+#include "base/thread_pool.h"
+
+namespace base {
+
+namespace internal {
+
+// 协程帧的分配器. 按照64字节对齐的大小分成若干类, 每一类在每一个线程上保存一个
+// 空闲链表, 释放的帧放回当前线程的链表(协程可能在另一个线程上结束, 这没有关系,
+// 内存本身没有线程归属). 超过kMaxPooledSize的帧直接使用operator new.
+class CoroutineFrameAllocator {
+ public:
+	 static constexpr std::size_t kGranularity = 64;
+	 static constexpr std::size_t kMaxPooledSize = 1024;
+	 static constexpr std::size_t kMaxCachedPerClass = 64;
+
+	 static void* Allocate(std::size_t size) {
+		 const std::size_t size_class = SizeClass(size);
+		 if (size_class < kClassCount) {
+			 Cache& cache = GetCache();
+			 if (FreeBlock* block = cache.free_lists[size_class]) {
+				 cache.free_lists[size_class] = block->next;
+				 cache.counts[size_class]--;
+				 return block;
+			 }
+			 return ::operator new((size_class + 1) * kGranularity);
+		 }
+		 return ::operator new(size);
+	 }
+
+	 static void Free(void* pointer, std::size_t size) {
+		 const std::size_t size_class = SizeClass(size);
+		 if (size_class < kClassCount) {
+			 Cache& cache = GetCache();
+			 if (cache.counts[size_class] < kMaxCachedPerClass) {
+				 FreeBlock* block = static_cast<FreeBlock*>(pointer);
+				 block->next = cache.free_lists[size_class];
+				 cache.free_lists[size_class] = block;
+				 cache.counts[size_class]++;
+				 return;
+			 }
+		 }
+		 ::operator delete(pointer);
+	 }
+
+ private:
+	 static constexpr std::size_t kClassCount = kMaxPooledSize / kGranularity;
+
+	 struct FreeBlock {
+		 FreeBlock* next;
+	 };
+
+	 struct Cache {
+		 Cache() {
+			 for (std::size_t i = 0; i < kClassCount; ++i) {
+				 free_lists[i] = nullptr;
+				 counts[i] = 0;
+			 }
+		 }
+
+		 ~Cache() {
+			 for (std::size_t i = 0; i < kClassCount; ++i) {
+				 while (FreeBlock* block = free_lists[i]) {
+					 free_lists[i] = block->next;
+					 ::operator delete(block);
+				 }
+			 }
+		 }
+
+		 FreeBlock* free_lists[kClassCount];
+		 std::size_t counts[kClassCount];
+	 };
+
+	 static std::size_t SizeClass(std::size_t size) {
+		 return (size + kGranularity - 1) / kGranularity - 1;
+	 }
+
+	 static Cache& GetCache() {
+		 static thread_local Cache cache;
+		 return cache;
+	 }
+};
+
+template <typename T>
+class CoTaskPromise;
+
+// CoTask的promise共有的部分: 分配器, 异常, 结束以后恢复等待者.
+class CoTaskPromiseBase {
+ public:
+	 static void* operator new(std::size_t size) {
+		 return CoroutineFrameAllocator::Allocate(size);
+	 }
+
+	 static void operator delete(void* pointer, std::size_t size) {
+		 CoroutineFrameAllocator::Free(pointer, size);
+	 }
+
+	 std::suspend_always initial_suspend() noexcept { return {}; }
+
+	 struct FinalAwaiter {
+		 bool await_ready() noexcept { return false; }
+
+		 template <typename Promise>
+		 std::coroutine_handle<> await_suspend(
+			 std::coroutine_handle<Promise> handle) noexcept {
+			 CoTaskPromiseBase& promise = handle.promise();
+			 if (promise.continuation_)
+				 return promise.continuation_;
+
+			 // Detach()以后没有人等待, 自己销毁.
+			 if (promise.detached_)
+				 handle.destroy();
+			 return std::noop_coroutine();
+		 }
+
+		 void await_resume() noexcept {}
+	 };
+
+	 FinalAwaiter final_suspend() noexcept { return {}; }
+
+	 void unhandled_exception() {
+		 // 没有人等待的协程抛出的异常没有地方可以传递.
+		 DCHECK(!detached_);
+		 exception_ = std::current_exception();
+	 }
+
+	 void set_continuation(std::coroutine_handle<> continuation) {
+		 continuation_ = continuation;
+	 }
+
+	 void set_detached() { detached_ = true; }
+
+ protected:
+	 void RethrowIfFailed() {
+		 if (exception_)
+			 std::rethrow_exception(exception_);
+	 }
+
+ private:
+	 std::coroutine_handle<> continuation_;
+	 std::exception_ptr exception_;
+	 bool detached_ = false;
+};
+
+}	// namespace internal.
+
+// 协程的返回类型. 协程创建以后不会马上执行, 直到被co_await或者Detach().
+//
+// co_await 一个CoTask会执行它, 它结束以后在它结束的线程上继续执行等待者, 返回
+// co_return的值, 或者重新抛出它的异常.
+template <typename T = void>
+class CoTask {
+ public:
+	 using promise_type = internal::CoTaskPromise<T>;
+	 using Handle = std::coroutine_handle<promise_type>;
+
+	 explicit CoTask(Handle handle) : handle_(handle) {}
+
+	 CoTask(CoTask&& other) noexcept
+		 : handle_(std::exchange(other.handle_, nullptr)) {}
+
+	 CoTask& operator=(CoTask&& other) noexcept {
+		 if (this != &other) {
+			 if (handle_)
+				 handle_.destroy();
+			 handle_ = std::exchange(other.handle_, nullptr);
+		 }
+		 return *this;
+	 }
+
+	 ~CoTask() {
+		 if (handle_)
+			 handle_.destroy();
+	 }
+
+	 // 在当前线程上开始执行, 不再等待它的结果, 协程结束以后自己销毁.
+	 void Detach() && {
+		 DCHECK(static_cast<bool>(handle_));
+		 Handle handle = std::exchange(handle_, nullptr);
+		 handle.promise().set_detached();
+		 handle.resume();
+	 }
+
+	 bool await_ready() const noexcept { return false; }
+
+	 std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) {
+		 handle_.promise().set_continuation(awaiting);
+		 return handle_;
+	 }
+
+	 T await_resume() { return handle_.promise().TakeResult(); }
+
+ private:
+	 Handle handle_;
+
+	 DISALLOW_COPY_AND_ASSIGN(CoTask);
+};
+
+namespace internal {
+
+template <typename T>
+class CoTaskPromise : public CoTaskPromiseBase {
+ public:
+	 CoTask<T> get_return_object() {
+		 return CoTask<T>(std::coroutine_handle<CoTaskPromise>::from_promise(*this));
+	 }
+
+	 template <typename U>
+	 void return_value(U&& value) {
+		 new (&storage_) T(std::forward<U>(value));
+		 has_value_ = true;
+	 }
+
+	 T TakeResult() {
+		 RethrowIfFailed();
+		 DCHECK(has_value_);
+		 return std::move(*reinterpret_cast<T*>(&storage_));
+	 }
+
+	 ~CoTaskPromise() {
+		 if (has_value_)
+			 reinterpret_cast<T*>(&storage_)->~T();
+	 }
+
+ private:
+	 typename std::aligned_storage<sizeof(T), alignof(T)>::type storage_;
+	 bool has_value_ = false;
+};
+
+template <>
+class CoTaskPromise<void> : public CoTaskPromiseBase {
+ public:
+	 CoTask<void> get_return_object() {
+		 return CoTask<void>(
+			 std::coroutine_handle<CoTaskPromise>::from_promise(*this));
+	 }
+
+	 void return_void() {}
+
+	 void TakeResult() { RethrowIfFailed(); }
+};
+
+// co_await task_runner->Schedule() / ScheduleAfter(delay) 返回的awaiter.
+// 把"恢复协程"作为一个任务post到|task_runner_|上. 如果post失败(比如message loop
+// 已经退出), 在当前线程上马上恢复, await_resume()返回false.
+class TaskRunnerAwaiter {
+ public:
+	 TaskRunnerAwaiter(TaskRunner* task_runner, TimeDelta delay)
+		 : task_runner_(task_runner), delay_(delay) {}
+
+	 bool await_ready() const noexcept { return false; }
+
+	 bool await_suspend(std::coroutine_handle<> handle) {
+		 // post成功以后协程可能马上就在另一个线程上恢复甚至结束了, 这个awaiter
+		 // 在协程帧里面, 所以之后不能再访问|this|.
+		 if (task_runner_->PostDelayedTask(
+				 FROM_HERE, OnceClosure([handle]() { handle.resume(); }), delay_)) {
+			 return true;
+		 }
+		 posted_ = false;
+		 return false;
+	 }
+
+	 bool await_resume() const noexcept { return posted_; }
+
+ private:
+	 TaskRunner* task_runner_;
+	 TimeDelta delay_;
+	 bool posted_ = true;
+};
+
+// co_await pool->Schedule() 返回的awaiter, 在线程池的某一个工作线程上恢复.
+class ThreadPoolAwaiter {
+ public:
+	 explicit ThreadPoolAwaiter(ThreadPool* pool) : pool_(pool) {}
+
+	 bool await_ready() const noexcept { return false; }
+
+	 void await_suspend(std::coroutine_handle<> handle) {
+		 // 只捕获了一个指针, 保存在FunctionWrapper内部，不会分配内存.
+		 pool_->PostTask([handle]() { handle.resume(); });
+	 }
+
+	 void await_resume() const noexcept {}
+
+ private:
+	 ThreadPool* pool_;
+};
+
+}	// namespace internal.
+
+inline internal::TaskRunnerAwaiter TaskRunner::Schedule() {
+	return internal::TaskRunnerAwaiter(this, TimeDelta());
+}
+
+inline internal::TaskRunnerAwaiter TaskRunner::ScheduleAfter(TimeDelta delay) {
+	return internal::TaskRunnerAwaiter(this, delay);
+}
+
+inline internal::ThreadPoolAwaiter ThreadPool::Schedule() {
+	return internal::ThreadPoolAwaiter(this);
+}
+
+// 在|pool|上执行|f|, 在执行完的那个工作线程上继续执行等待者, 返回|f|的结果.
+//   int result = co_await base::RunOnThreadPool(pool, [] { return Compute(); });
+template <typename Function>
+auto RunOnThreadPool(ThreadPool* pool, Function f)
+	-> CoTask<std::invoke_result_t<Function>> {
+	co_await pool->Schedule();
+	co_return f();
+}
+
+}	// namespace base.
+
+#endif	// defined(__cpp_impl_coroutine)
+
+#endif // !BASE_TASK_COROUTINE_H
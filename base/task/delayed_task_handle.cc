@@ -0,0 +1,38 @@
+﻿/**
+* @Author: YangGuang
+* @Date:   2026-10-17
+* @Email:  guang334419520@126.com
+* @Filename: delayed_task_handle.cc
+* @Last modified by:  YangGuang
+*/
+#include "base/task/delayed_task_handle.h"
+
+#include <utility>
+
+namespace base {
+
+DelayedTaskHandle::DelayedTaskHandle() = default;
+
+DelayedTaskHandle::DelayedTaskHandle(std::unique_ptr<Delegate> delegate)
+	: delegate_(std::move(delegate)) {}
+
+DelayedTaskHandle::~DelayedTaskHandle() = default;
+
+DelayedTaskHandle::DelayedTaskHandle(DelayedTaskHandle&& other) noexcept =
+	default;
+
+DelayedTaskHandle& DelayedTaskHandle::operator=(
+	DelayedTaskHandle&& other) noexcept = default;
+
+bool DelayedTaskHandle::IsValid() const {
+	return delegate_ && delegate_->IsValid();
+}
+
+void DelayedTaskHandle::CancelTask() {
+	if (!delegate_)
+		return;
+	delegate_->CancelTask();
+	delegate_.reset();
+}
+
+}	// namespace base.
@@ -0,0 +1,58 @@
+﻿/**
+* @Author: YangGuang
+* @Date:   2026-10-17
+* @Email:  guang334419520@126.com
+* @Filename: delayed_task_handle.h
+* @Last modified by:  YangGuang
+*/
+#ifndef BASE_TASK_DELAYED_TASK_HANDLE_H
+#define BASE_TASK_DELAYED_TASK_HANDLE_H
+
+#include <memory>
+
+#include "base/base_export.h"
+#include "base/macor.h"
+
+namespace base {
+
+// SequencedTaskRunner::PostCancelableDelayedTask() 返回的句柄, 用来取消还没有
+// 运行的任务. 只能移动, 析构的时候不会取消任务.
+//
+// 除了析构以外, 所有的方法都只能在任务提交到的那个序列上调用.
+class BASE_EXPORT DelayedTaskHandle {
+ public:
+	 // 由TaskRunner实现, 决定怎么样取消一个任务.
+	 class BASE_EXPORT Delegate {
+	  public:
+		  virtual ~Delegate() = default;
+
+		  // 任务还没有运行也没有被取消的时候返回true.
+		  virtual bool IsValid() const = 0;
+
+		  // 取消任务, 任务持有的资源会被马上释放.
+		  virtual void CancelTask() = 0;
+	 };
+
+	 // 构造一个无效的句柄.
+	 DelayedTaskHandle();
+	 explicit DelayedTaskHandle(std::unique_ptr<Delegate> delegate);
+	 ~DelayedTaskHandle();
+
+	 DelayedTaskHandle(DelayedTaskHandle&& other) noexcept;
+	 DelayedTaskHandle& operator=(DelayedTaskHandle&& other) noexcept;
+
+	 // 任务还在等待运行的时候返回true, 任务开始运行或者被取消以后返回false.
+	 bool IsValid() const;
+
+	 // 取消任务, 之后IsValid()返回false. 句柄无效的时候什么都不做.
+	 void CancelTask();
+
+ private:
+	 std::unique_ptr<Delegate> delegate_;
+
+	 DISALLOW_COPY_AND_ASSIGN(DelayedTaskHandle);
+};
+
+}	// namespace base.
+
+#endif // !BASE_TASK_DELAYED_TASK_HANDLE_H
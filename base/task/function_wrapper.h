@@ -0,0 +1,163 @@
+﻿/**
+* @Author: YangGuang
+* @Date:   2026-10-17
+* @Email:  guang334419520@126.com
+* @Filename: function_wrapper.h
+* @Last modified by:  YangGuang
+*/
+#ifndef BASE_TASK_FUNCTION_WRAPPER_H
+#define BASE_TASK_FUNCTION_WRAPPER_H
+
+#include <stddef.h>
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#include "base/base_export.h"
+#include "base/macor.h"
+
+namespace base {
+
+// 一个只能移动的、类型擦除的 void() 可调用对象, 用来保存线程池的任务.
+// 和std::function不一样，它可以保存std::packaged_task这样只能移动的对象.
+//
+// 不超过kInlineSize字节、并且移动构造不会抛异常的可调用对象直接保存在对象内部,
+// 不会有任何的堆分配, 大部分只捕获了几个指针或者整数的lambda都满足这个条件.
+// 更大的对象才会分配在堆上.
+class BASE_EXPORT FunctionWrapper {
+ public:
+	 static constexpr std::size_t kInlineSize = 48;
+
+	 FunctionWrapper() = default;
+
+	 template <typename Function,
+			   typename = typename std::enable_if<!std::is_same<
+				   typename std::decay<Function>::type,
+				   FunctionWrapper>::value>::type>
+	 FunctionWrapper(Function&& f) {
+		 using Functor = typename std::decay<Function>::type;
+		 Construct<Functor>(std::forward<Function>(f),
+							std::integral_constant<bool, IsInline<Functor>()>());
+	 }
+
+	 FunctionWrapper(FunctionWrapper&& other) noexcept {
+		 MoveFrom(other);
+	 }
+
+	 FunctionWrapper& operator=(FunctionWrapper&& other) noexcept {
+		 if (this != &other) {
+			 Reset();
+			 MoveFrom(other);
+		 }
+		 return *this;
+	 }
+
+	 ~FunctionWrapper() { Reset(); }
+
+	 void operator()() { ops_->invoke(&storage_); }
+
+	 bool is_null() const { return ops_ == nullptr; }
+
+	 explicit operator bool() const { return !is_null(); }
+
+	 void Reset() {
+		 if (ops_) {
+			 ops_->destroy(&storage_);
+			 ops_ = nullptr;
+		 }
+	 }
+
+ private:
+	 using Storage = typename std::aligned_storage<kInlineSize,
+		 alignof(std::max_align_t)>::type;
+
+	 struct Ops {
+		 void (*invoke)(Storage* storage);
+		 // 把|src|里面的对象移动到|dst|, 并且析构|src|里面的对象.
+		 void (*relocate)(Storage* dst, Storage* src);
+		 void (*destroy)(Storage* storage);
+	 };
+
+	 template <typename Functor>
+	 static constexpr bool IsInline() {
+		 return sizeof(Functor) <= sizeof(Storage) &&
+			 alignof(Storage) % alignof(Functor) == 0 &&
+			 std::is_nothrow_move_constructible<Functor>::value;
+	 }
+
+	 // 保存在内部的可调用对象.
+	 template <typename Functor>
+	 struct InlineOps {
+		 static Functor* Get(Storage* storage) {
+			 return reinterpret_cast<Functor*>(storage);
+		 }
+		 static void Invoke(Storage* storage) { (*Get(storage))(); }
+		 static void Relocate(Storage* dst, Storage* src) {
+			 new (dst) Functor(std::move(*Get(src)));
+			 Get(src)->~Functor();
+		 }
+		 static void Destroy(Storage* storage) { Get(storage)->~Functor(); }
+
+		 static const Ops kOps;
+	 };
+
+	 // 保存在堆上的可调用对象, |storage_|里面只有一个指针.
+	 template <typename Functor>
+	 struct HeapOps {
+		 static Functor*& Get(Storage* storage) {
+			 return *reinterpret_cast<Functor**>(storage);
+		 }
+		 static void Invoke(Storage* storage) { (*Get(storage))(); }
+		 static void Relocate(Storage* dst, Storage* src) {
+			 new (dst) Functor*(Get(src));
+		 }
+		 static void Destroy(Storage* storage) { delete Get(storage); }
+
+		 static const Ops kOps;
+	 };
+
+	 template <typename Functor, typename Function>
+	 void Construct(Function&& f, std::true_type /* inline */) {
+		 new (&storage_) Functor(std::forward<Function>(f));
+		 ops_ = &InlineOps<Functor>::kOps;
+	 }
+
+	 template <typename Functor, typename Function>
+	 void Construct(Function&& f, std::false_type /* inline */) {
+		 new (&storage_) Functor*(new Functor(std::forward<Function>(f)));
+		 ops_ = &HeapOps<Functor>::kOps;
+	 }
+
+	 void MoveFrom(FunctionWrapper& other) {
+		 ops_ = other.ops_;
+		 if (ops_) {
+			 ops_->relocate(&storage_, &other.storage_);
+			 other.ops_ = nullptr;
+		 }
+	 }
+
+	 Storage storage_;
+	 const Ops* ops_ = nullptr;
+
+	 DISALLOW_COPY_AND_ASSIGN(FunctionWrapper);
+};
+
+template <typename Functor>
+const FunctionWrapper::Ops FunctionWrapper::InlineOps<Functor>::kOps = {
+	&FunctionWrapper::InlineOps<Functor>::Invoke,
+	&FunctionWrapper::InlineOps<Functor>::Relocate,
+	&FunctionWrapper::InlineOps<Functor>::Destroy,
+};
+
+template <typename Functor>
+const FunctionWrapper::Ops FunctionWrapper::HeapOps<Functor>::kOps = {
+	&FunctionWrapper::HeapOps<Functor>::Invoke,
+	&FunctionWrapper::HeapOps<Functor>::Relocate,
+	&FunctionWrapper::HeapOps<Functor>::Destroy,
+};
+
+}	// namespace base.
+
+#endif // !BASE_TASK_FUNCTION_WRAPPER_H
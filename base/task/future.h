@@ -0,0 +1,615 @@
+﻿/**
+* @Author: YangGuang
+* @Date:   2026-10-17
+* @Email:  guang334419520@126.com
+* @Filename: future.h
+* @Last modified by:  YangGuang
+*/
+#ifndef BASE_TASK_FUTURE_H
+#define BASE_TASK_FUTURE_H
+
+// base::Promise<T> / base::Future<T>, 可以组合的异步结果.
+//
+// 和std::future不一样，Future可以注册continuation, 结果准备好以后在完成它的线程
+// 上(或者post到指定的TaskRunner上)执行, 组合异步结果的时候不需要任何线程阻塞.
+//
+// Sample usage:
+//   base::Future<int> size = pool->AddWork([] { return LoadFile().size(); });
+//   std::move(size).Then(ui_task_runner, [](int size) {
+//     ShowSize(size);
+//   });
+//
+//   std::vector<base::Future<int>> parts;
+//   for (auto& shard : shards)
+//     parts.push_back(pool->AddWork([&shard] { return Count(shard); }));
+//   base::WhenAll(std::move(parts)).Then([](std::vector<int> counts) {
+//     ...
+//   });
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+#include <chrono>
+#include <exception>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "base/base_export.h"
+#include "base/callback.h"
+#include "base/location.h"
+#include "base/logging.h"
+#include "base/macor.h"
+#include "base/task/function_wrapper.h"
+#include "base/task/helping_wait.h"
+#include "base/task_runner.h"
+#include "base/threading/event_count.h"
+
+namespace base {
+
+class ThreadPool;
+
+template <typename T>
+class Future;
+
+template <typename T>
+class Promise;
+
+namespace internal {
+
+// 由thread_pool.cc实现, 这样这个头文件不需要include thread_pool.h
+// (thread_pool.h 需要include这个头文件).
+
+// 调用线程是某一个线程池的工作线程的话返回这个线程池, 否则返回nullptr.
+BASE_EXPORT ThreadPool* GetCurrentWorkerThreadPool();
+
+// 保存结果, 小的结果直接保存在共享状态里面，不会再单独分配内存.
+template <typename T>
+class FutureValue {
+ public:
+	 FutureValue() = default;
+
+	 ~FutureValue() {
+		 if (has_value_)
+			 Get()->~T();
+	 }
+
+	 template <typename U>
+	 void Set(U&& value) {
+		 DCHECK(!has_value_);
+		 new (&storage_) T(std::forward<U>(value));
+		 has_value_ = true;
+	 }
+
+	 T Take() {
+		 DCHECK(has_value_);
+		 return std::move(*Get());
+	 }
+
+ private:
+	 T* Get() { return reinterpret_cast<T*>(&storage_); }
+
+	 typename std::aligned_storage<sizeof(T), alignof(T)>::type storage_;
+	 bool has_value_ = false;
+
+	 DISALLOW_COPY_AND_ASSIGN(FutureValue);
+};
+
+template <>
+class FutureValue<void> {
+ public:
+	 FutureValue() = default;
+
+	 void Set() {}
+
+	 void Take() {}
+
+ private:
+	 DISALLOW_COPY_AND_ASSIGN(FutureValue);
+};
+
+// Promise和Future共享的状态.
+//
+// 结果和continuation各自只会被写一次, 用一个原子的标志位同步: 写结果的一方和注册
+// continuation的一方各自写完以后用fetch_or设置自己的标志位, 后到的一方负责执行
+// continuation. 整个过程没有锁.
+//
+// 阻塞等待的线程不占用continuation, 而是设置kHasWaiter以后在|ready_event_|上
+// 睡眠, 写结果的一方看到kHasWaiter才会去唤醒, 没有等待者的时候不多花任何代价.
+template <typename T>
+class FutureState {
+ public:
+	 FutureState() : flags_(0) {}
+
+	 template <typename... Args>
+	 void SetValue(Args&&... args) {
+		 value_.Set(std::forward<Args>(args)...);
+		 Complete();
+	 }
+
+	 void SetException(std::exception_ptr exception) {
+		 exception_ = exception;
+		 Complete();
+	 }
+
+	 // 只能调用一次, 如果结果已经准备好了，在调用线程上马上执行.
+	 void SetContinuation(FunctionWrapper continuation) {
+		 continuation_ = std::move(continuation);
+		 const uint32_t previous =
+			 flags_.fetch_or(kHasContinuation, std::memory_order_acq_rel);
+		 DCHECK(!(previous & kHasContinuation));
+		 if (previous & kReady)
+			 RunContinuation();
+	 }
+
+	 bool IsReady() const {
+		 return (flags_.load(std::memory_order_acquire) & kReady) != 0;
+	 }
+
+	 // 阻塞直到结果准备好, 可以调用多次.
+	 void WaitUntilReady() {
+		 while (!IsReady()) {
+			 EventCount::Key key;
+			 if (PrepareWait(&key))
+				 ready_event_.Wait(key);
+		 }
+	 }
+
+	 // 和WaitUntilReady()一样, 但是最多睡眠|timeout|, 返回结果是否已经准备好.
+	 bool WaitUntilReadyFor(std::chrono::nanoseconds timeout) {
+		 EventCount::Key key;
+		 if (PrepareWait(&key))
+			 ready_event_.WaitFor(key, timeout);
+		 return IsReady();
+	 }
+
+	 bool HasContinuation() const {
+		 return (flags_.load(std::memory_order_acquire) & kHasContinuation) != 0;
+	 }
+
+	 // 只能在IsReady()以后调用一次.
+	 T TakeValue() {
+		 DCHECK(IsReady());
+		 if (exception_)
+			 std::rethrow_exception(exception_);
+		 return value_.Take();
+	 }
+
+ private:
+	 enum : uint32_t {
+		 kReady = 1 << 0,
+		 kHasContinuation = 1 << 1,
+		 kHasWaiter = 1 << 2,
+	 };
+
+	 // 结果还没有准备好的时候返回true, 之后必须调用ready_event_.Wait*().
+	 bool PrepareWait(EventCount::Key* key) {
+		 *key = ready_event_.PrepareWait();
+		 // fetch_or和Complete()里面的fetch_or有先后顺序: 我们在后面的话能看到
+		 // kReady, 在前面的话Complete()能看到kHasWaiter并且唤醒我们.
+		 const uint32_t previous =
+			 flags_.fetch_or(kHasWaiter, std::memory_order_acq_rel);
+		 if (previous & kReady) {
+			 ready_event_.CancelWait();
+			 return false;
+		 }
+		 return true;
+	 }
+
+	 void Complete() {
+		 const uint32_t previous =
+			 flags_.fetch_or(kReady, std::memory_order_acq_rel);
+		 DCHECK(!(previous & kReady));
+		 // 必须在continuation之前唤醒, continuation执行完以后这个状态可能已经
+		 // 被释放了.
+		 if (previous & kHasWaiter)
+			 ready_event_.NotifyAll();
+		 if (previous & kHasContinuation)
+			 RunContinuation();
+	 }
+
+	 void RunContinuation() {
+		 // continuation一般持有这个状态的引用，执行完马上释放，打破循环引用.
+		 FunctionWrapper continuation = std::move(continuation_);
+		 continuation();
+	 }
+
+	 std::atomic<uint32_t> flags_;
+	 EventCount ready_event_;
+	 FutureValue<T> value_;
+	 std::exception_ptr exception_;
+	 FunctionWrapper continuation_;
+
+	 DISALLOW_COPY_AND_ASSIGN(FutureState);
+};
+
+// 执行|function|, 把结果或者异常交给|promise|. try只包住|function|: SetValue()
+// 会在这个线程上同步执行continuation, continuation抛出的异常不属于|function|,
+// 不能再交给已经完成的|promise|, 而是从这里传播给调用者(见OnComplete()).
+template <typename R>
+struct PromiseFulfiller {
+	template <typename Function>
+	static void Run(Promise<R>& promise, Function& function) {
+		FutureValue<R> value;
+		std::exception_ptr exception;
+		try {
+			value.Set(function());
+		}
+		catch (...) {
+			exception = std::current_exception();
+		}
+		if (exception)
+			promise.SetException(exception);
+		else
+			promise.SetValue(value.Take());
+	}
+};
+
+template <>
+struct PromiseFulfiller<void> {
+	template <typename PromiseType, typename Function>
+	static void Run(PromiseType& promise, Function& function) {
+		std::exception_ptr exception;
+		try {
+			function();
+		}
+		catch (...) {
+			exception = std::current_exception();
+		}
+		if (exception)
+			promise.SetException(exception);
+		else
+			promise.SetValue();
+	}
+};
+
+// 用一个已经准备好的Future的结果调用|function|.
+template <typename T>
+struct ContinuationInvoker {
+	template <typename Function>
+	using Result = std::invoke_result_t<Function, T>;
+
+	template <typename Function>
+	static Result<Function> Run(Function& function, Future<T> ready) {
+		return function(std::move(ready).Get());
+	}
+};
+
+template <>
+struct ContinuationInvoker<void> {
+	template <typename Function>
+	using Result = std::invoke_result_t<Function>;
+
+	template <typename Function, typename ReadyFuture>
+	static Result<Function> Run(Function& function, ReadyFuture ready) {
+		std::move(ready).Get();
+		return function();
+	}
+};
+
+}	// namespace internal.
+
+// Promise是写结果的一方, 只能写一次. 没有写结果就析构的Promise会给Future设置
+// std::future_error(broken_promise).
+template <typename T>
+class Promise {
+ public:
+	 Promise() : state_(std::make_shared<internal::FutureState<T>>()) {}
+
+	 Promise(Promise&& other) noexcept
+		 : state_(std::move(other.state_)),
+		   future_retrieved_(other.future_retrieved_),
+		   fulfilled_(other.fulfilled_) {}
+
+	 Promise& operator=(Promise&& other) noexcept {
+		 if (this != &other) {
+			 Abandon();
+			 state_ = std::move(other.state_);
+			 future_retrieved_ = other.future_retrieved_;
+			 fulfilled_ = other.fulfilled_;
+		 }
+		 return *this;
+	 }
+
+	 ~Promise() { Abandon(); }
+
+	 // 只能调用一次.
+	 Future<T> GetFuture() {
+		 DCHECK(!future_retrieved_);
+		 future_retrieved_ = true;
+		 return Future<T>(state_);
+	 }
+
+	 template <typename... Args>
+	 void SetValue(Args&&... args) {
+		 DCHECK(!fulfilled_);
+		 fulfilled_ = true;
+		 state_->SetValue(std::forward<Args>(args)...);
+	 }
+
+	 void SetException(std::exception_ptr exception) {
+		 DCHECK(!fulfilled_);
+		 fulfilled_ = true;
+		 state_->SetException(exception);
+	 }
+
+ private:
+	 void Abandon() {
+		 if (state_ && !fulfilled_) {
+			 fulfilled_ = true;
+			 state_->SetException(std::make_exception_ptr(
+				 std::future_error(std::future_errc::broken_promise)));
+		 }
+	 }
+
+	 std::shared_ptr<internal::FutureState<T>> state_;
+	 bool future_retrieved_ = false;
+	 bool fulfilled_ = false;
+
+	 DISALLOW_COPY_AND_ASSIGN(Promise);
+};
+
+// Future是读结果的一方, 只能消费一次: Get(), Then() 或者 OnComplete() 之中的一个.
+template <typename T>
+class Future {
+ public:
+	 Future() = default;
+	 Future(Future&& other) noexcept = default;
+	 Future& operator=(Future&& other) noexcept = default;
+
+	 bool is_valid() const { return state_ != nullptr; }
+
+	 bool IsReady() const {
+		 DCHECK(is_valid());
+		 return state_->IsReady();
+	 }
+
+	 // 等待直到结果准备好. 在线程池的工作线程上调用的时候会帮助执行这个线程池
+	 // 里面的任务(见Wait(ThreadPool*)), 其他线程上会阻塞. 不会消费这个Future,
+	 // 之后还可以调用Get(), Then() 或者 OnComplete().
+	 void Wait() {
+		 DCHECK(is_valid());
+		 if (state_->IsReady())
+			 return;
+
+		 if (ThreadPool* pool = internal::GetCurrentWorkerThreadPool()) {
+			 Wait(pool);
+			 return;
+		 }
+
+		 state_->WaitUntilReady();
+	 }
+
+	 // 一边等待一边执行|pool|里面的任务(自己的队列，线程池的队列，偷取), 直到
+	 // 结果准备好. 结果依赖同一个线程池里面的其他任务的时候(比如递归的并行算法),
+	 // 工作线程用这个等待不会死锁. 找不到任务的时候会在这个Future上睡眠一会儿,
+	 // 见internal::HelpingWait().
+	 void Wait(ThreadPool* pool) {
+		 DCHECK(is_valid());
+		 internal::HelpingWait(pool, state_.get());
+	 }
+
+	 // 返回结果或者重新抛出异常, 没有准备好的时候先Wait().
+	 T Get() && {
+		 Wait();
+		 std::shared_ptr<internal::FutureState<T>> state = std::move(state_);
+		 return state->TakeValue();
+	 }
+
+	 // 和Get()一样，但是等待的时候帮助|pool|执行任务.
+	 T Get(ThreadPool* pool) && {
+		 Wait(pool);
+		 std::shared_ptr<internal::FutureState<T>> state = std::move(state_);
+		 return state->TakeValue();
+	 }
+
+	 // 结果准备好以后用一个已经准备好的Future调用|callback|, 在完成结果的线程上
+	 // 执行(如果已经准备好了，在调用线程上马上执行). |callback|不应该抛出异常:
+	 // 它是在Promise::SetValue()/SetException()里面执行的, 异常会从那里传播给
+	 // 完成结果的一方, 而这个Future的结果不会受影响. Then()的函数抛出的异常会
+	 // 交给返回的Future, 不会走到这里.
+	 template <typename Callback>
+	 void OnComplete(Callback callback) && {
+		 DCHECK(is_valid());
+		 std::shared_ptr<internal::FutureState<T>> state = std::move(state_);
+		 internal::FutureState<T>* raw = state.get();
+		 raw->SetContinuation(
+			 [state = std::move(state), callback = std::move(callback)]() mutable {
+				 callback(Future<T>(std::move(state)));
+			 });
+	 }
+
+	 // 结果准备好以后在完成结果的线程上调用|function|(value), 返回它的结果.
+	 // 如果这个Future是一个异常, 不会调用|function|, 异常直接传递给返回的Future.
+	 template <typename Function,
+			   typename R = typename internal::ContinuationInvoker<T>::
+				   template Result<Function>>
+	 Future<R> Then(Function function) && {
+		 Promise<R> promise;
+		 Future<R> result = promise.GetFuture();
+		 std::move(*this).OnComplete(
+			 [promise = std::move(promise), function = std::move(function)](
+				 Future<T> ready) mutable {
+				 auto invoke = [&]() {
+					 return internal::ContinuationInvoker<T>::Run(
+						 function, std::move(ready));
+				 };
+				 internal::PromiseFulfiller<R>::Run(promise, invoke);
+			 });
+		 return result;
+	 }
+
+	 // 和Then()一样, 但是|function|会被post到|task_runner|上执行.
+	 template <typename Function,
+			   typename R = typename internal::ContinuationInvoker<T>::
+				   template Result<Function>>
+	 Future<R> Then(TaskRunner* task_runner, Function function) && {
+		 DCHECK_NOTNULL(task_runner);
+		 Promise<R> promise;
+		 Future<R> result = promise.GetFuture();
+		 std::move(*this).OnComplete(
+			 [task_runner, promise = std::move(promise),
+			  function = std::move(function)](Future<T> ready) mutable {
+				 // OnceClosure需要可以复制的函数对象, 所以把状态放到shared_ptr里面.
+				 struct Context {
+					 Promise<R> promise;
+					 Function function;
+					 Future<T> ready;
+				 };
+				 auto context = std::make_shared<Context>(Context{
+					 std::move(promise), std::move(function), std::move(ready) });
+				 task_runner->PostTask(FROM_HERE, OnceClosure([context]() {
+					 auto invoke = [&]() {
+						 return internal::ContinuationInvoker<T>::Run(
+							 context->function, std::move(context->ready));
+					 };
+					 internal::PromiseFulfiller<R>::Run(context->promise, invoke);
+				 }));
+			 });
+		 return result;
+	 }
+
+ private:
+	 friend class Promise<T>;
+
+	 explicit Future(std::shared_ptr<internal::FutureState<T>> state)
+		 : state_(std::move(state)) {}
+
+	 std::shared_ptr<internal::FutureState<T>> state_;
+
+	 DISALLOW_COPY_AND_ASSIGN(Future);
+};
+
+template <typename T>
+Future<typename std::decay<T>::type> MakeReadyFuture(T&& value) {
+	Promise<typename std::decay<T>::type> promise;
+	promise.SetValue(std::forward<T>(value));
+	return promise.GetFuture();
+}
+
+inline Future<void> MakeReadyFuture() {
+	Promise<void> promise;
+	promise.SetValue();
+	return promise.GetFuture();
+}
+
+namespace internal {
+
+template <typename T>
+struct WhenAllTraits {
+	using Result = std::vector<T>;
+
+	static Result Collect(std::vector<Future<T>>& ready) {
+		Result values;
+		values.reserve(ready.size());
+		for (auto& future : ready)
+			values.push_back(std::move(future).Get());
+		return values;
+	}
+};
+
+template <>
+struct WhenAllTraits<void> {
+	using Result = void;
+
+	static void Collect(std::vector<Future<void>>& ready) {
+		for (auto& future : ready)
+			std::move(future).Get();
+	}
+};
+
+template <typename T>
+struct WhenAnyTraits {
+	using Result = std::pair<std::size_t, T>;
+
+	static Result Collect(std::size_t index, Future<T> ready) {
+		return Result(index, std::move(ready).Get());
+	}
+};
+
+template <>
+struct WhenAnyTraits<void> {
+	using Result = std::size_t;
+
+	static Result Collect(std::size_t index, Future<void> ready) {
+		std::move(ready).Get();
+		return index;
+	}
+};
+
+}	// namespace internal.
+
+// 所有的Future都完成以后完成, 结果按照顺序排列. 如果有Future是异常, 结果是
+// 顺序上第一个异常. Future<void>的结果是Future<void>.
+template <typename T>
+Future<typename internal::WhenAllTraits<T>::Result> WhenAll(
+	std::vector<Future<T>> futures) {
+	using Traits = internal::WhenAllTraits<T>;
+	using Result = typename Traits::Result;
+
+	struct Context {
+		explicit Context(std::size_t count) : ready(count), remaining(count) {}
+
+		Promise<Result> promise;
+		std::vector<Future<T>> ready;
+		std::atomic<std::size_t> remaining;
+	};
+
+	auto context = std::make_shared<Context>(futures.size());
+	Future<Result> result = context->promise.GetFuture();
+	if (futures.empty()) {
+		auto collect = [&context]() { return Traits::Collect(context->ready); };
+		internal::PromiseFulfiller<Result>::Run(context->promise, collect);
+		return result;
+	}
+
+	for (std::size_t i = 0; i < futures.size(); ++i) {
+		std::move(futures[i]).OnComplete([context, i](Future<T> ready) {
+			// 每一个位置只有一个写者, 最后一个完成的负责汇总.
+			context->ready[i] = std::move(ready);
+			if (context->remaining.fetch_sub(1, std::memory_order_acq_rel) != 1)
+				return;
+			auto collect = [&context]() { return Traits::Collect(context->ready); };
+			internal::PromiseFulfiller<Result>::Run(context->promise, collect);
+		});
+	}
+	return result;
+}
+
+// 任意一个Future完成以后完成, 结果是(下标, 值), Future<void>的结果是下标.
+// 第一个完成的如果是异常，结果就是这个异常.
+template <typename T>
+Future<typename internal::WhenAnyTraits<T>::Result> WhenAny(
+	std::vector<Future<T>> futures) {
+	using Traits = internal::WhenAnyTraits<T>;
+	using Result = typename Traits::Result;
+	DCHECK(!futures.empty());
+
+	struct Context {
+		Context() : done(false) {}
+
+		Promise<Result> promise;
+		std::atomic<bool> done;
+	};
+
+	auto context = std::make_shared<Context>();
+	Future<Result> result = context->promise.GetFuture();
+	for (std::size_t i = 0; i < futures.size(); ++i) {
+		std::move(futures[i]).OnComplete([context, i](Future<T> ready) {
+			if (context->done.exchange(true, std::memory_order_acq_rel))
+				return;
+			auto collect = [&]() { return Traits::Collect(i, std::move(ready)); };
+			internal::PromiseFulfiller<Result>::Run(context->promise, collect);
+		});
+	}
+	return result;
+}
+
+}	// namespace base.
+
+#endif // !BASE_TASK_FUTURE_H
@@ -0,0 +1,152 @@
+﻿/**
+* @Author: YangGuang
+* @Date:   2026-10-17
+* @Email:  guang334419520@126.com
+* @Filename: helping_wait.h
+* @Last modified by:  YangGuang
+*/
+#ifndef BASE_TASK_HELPING_WAIT_H
+#define BASE_TASK_HELPING_WAIT_H
+
+// 工作线程等待同一个线程池里面的其他任务的时候使用的等待方式: 一边等待一边
+// 帮助执行线程池里面的任务, 这样递归的并行算法不会死锁. 连续kHelpSpinRounds次
+// 找不到任务以后(结果可能正在别的线程上计算, 或者由别的线程池, MessageLoop完成),
+// 在等待的对象上睡眠(一般是一个EventCount), 每隔kHelpSleepInterval醒来再帮忙
+// 一次, 所以不会浪费一个核.
+//
+// Future::Wait(), ThreadPool::WaitFor(), ParallelJoinCounter 和 TaskGraph 都用
+// 这里的HelpingWait(), 不要再单独写一个等待的循环.
+
+#include <stddef.h>
+
+#include <atomic>
+#include <chrono>
+#include <future>
+
+#include "base/base_export.h"
+#include "base/logging.h"
+#include "base/macor.h"
+#include "base/threading/event_count.h"
+
+namespace base {
+
+class ThreadPool;
+
+namespace internal {
+
+// 由thread_pool.cc实现, 这样这个头文件不需要include thread_pool.h
+// (thread_pool.h 需要include这个头文件).
+
+// 等价于 pool->RunPendingTask(), 执行了一个任务的话返回true.
+BASE_EXPORT bool RunPendingTaskOnThreadPool(ThreadPool* pool);
+
+// 找不到任务的时候, 先这样重试几次再睡眠.
+constexpr int kHelpSpinRounds = 64;
+// 睡眠以后多久回来看一次线程池里面有没有新的任务.
+constexpr std::chrono::milliseconds kHelpSleepInterval{1};
+
+// 一边执行|pool|里面的任务一边等待, 直到|waitable|.IsReady(). Waitable需要提供:
+//   bool IsReady() const;
+//   // 最多睡眠|timeout|, 在这期间准备好了必须被唤醒.
+//   void WaitUntilReadyFor(std::chrono::nanoseconds timeout);
+template <typename Waitable>
+void HelpingWait(ThreadPool* pool, Waitable* waitable) {
+	DCHECK_NOTNULL(pool);
+	int idle_rounds = 0;
+	while (!waitable->IsReady()) {
+		if (RunPendingTaskOnThreadPool(pool)) {
+			idle_rounds = 0;
+			continue;
+		}
+		if (++idle_rounds < kHelpSpinRounds)
+			continue;
+		idle_rounds = 0;
+		waitable->WaitUntilReadyFor(kHelpSleepInterval);
+	}
+}
+
+// 让HelpingWait()可以等待std::future. std::future没有办法注册通知, 所以睡眠的
+// 时候只能用wait_for()等到超时.
+template <typename T>
+class StdFutureWaitable {
+ public:
+	 explicit StdFutureWaitable(const std::future<T>& future) : future_(future) {}
+
+	 bool IsReady() const {
+		 return future_.wait_for(std::chrono::seconds(0)) ==
+			 std::future_status::ready;
+	 }
+
+	 void WaitUntilReadyFor(std::chrono::nanoseconds timeout) {
+		 future_.wait_for(timeout);
+	 }
+
+ private:
+	 const std::future<T>& future_;
+
+	 DISALLOW_COPY_AND_ASSIGN(StdFutureWaitable);
+};
+
+// 等待一组任务全部完成的计数. 等待的线程自己也占一个计数, 所以计数在Wait()
+// 之前不会变成0. 每一个任务开始之前调用Add(1), 结束的时候调用Done().
+//
+// Done()可以是任务最后一次访问它所在的对象: 计数变成0以后Done()还会唤醒等待的
+// 线程, 所以IsReady()要等到唤醒也结束以后才返回true, Wait()返回以后调用者就
+// 可以马上释放这个对象.
+class JoinCount {
+ public:
+	 JoinCount() : count_(1), done_(false) {}
+
+	 void Add(std::size_t count) {
+		 count_.fetch_add(count, std::memory_order_relaxed);
+	 }
+
+	 void Done() {
+		 if (count_.fetch_sub(1, std::memory_order_acq_rel) != 1)
+			 return;
+		 done_event_.NotifyAll();
+		 // 之后不能再访问this.
+		 done_.store(true, std::memory_order_release);
+	 }
+
+	 // 重新开始一轮, 已经有|count|个任务. 只能在上一轮Wait()返回以后调用.
+	 void Reset(std::size_t count) {
+		 done_.store(false, std::memory_order_relaxed);
+		 count_.store(count + 1, std::memory_order_relaxed);
+	 }
+
+	 bool IsReady() const {
+		 return done_.load(std::memory_order_acquire);
+	 }
+
+	 void WaitUntilReadyFor(std::chrono::nanoseconds timeout) {
+		 EventCount::Key key = done_event_.PrepareWait();
+		 // 计数在Done()里面先变成0再唤醒: 我们看到0的话唤醒马上就会结束, 没有看到的
+		 // 话唤醒一定在PrepareWait()之后.
+		 if (count_.load(std::memory_order_acquire) == 0) {
+			 done_event_.CancelWait();
+			 return;
+		 }
+		 done_event_.WaitFor(key, timeout);
+	 }
+
+	 // 释放等待的线程自己的计数, 然后帮助|pool|执行任务直到所有的任务都调用了
+	 // Done().
+	 void Wait(ThreadPool* pool) {
+		 Done();
+		 HelpingWait(pool, this);
+	 }
+
+ private:
+	 std::atomic<std::size_t> count_;
+	 std::atomic<bool> done_;
+	 EventCount done_event_;
+
+	 DISALLOW_COPY_AND_ASSIGN(JoinCount);
+};
+
+}	// namespace internal.
+
+}	// namespace base.
+
+#endif // !BASE_TASK_HELPING_WAIT_H
@@ -0,0 +1,135 @@
+﻿/**
+* @Author: YangGuang
+* @Date:   2026-10-17
+* @Email:  guang334419520@126.com
+* @Filename: task_graph.cc
+* @Last modified by:  YangGuang
+*/
+#include "base/task/task_graph.h"
+
+#include "base/logging.h"
+#include "base/thread_pool.h"
+
+namespace base {
+
+TaskGraph::TaskGraph()
+	: running_(false),
+	  failed_(false) {}
+
+TaskGraph::~TaskGraph() {
+	DCHECK(!running_);
+}
+
+TaskGraph::NodeId TaskGraph::AddNode(Closure task) {
+	DCHECK(!running_);
+	Node node;
+	node.task = std::move(task);
+	nodes_.push_back(std::move(node));
+	prepared_ = false;
+	return nodes_.size() - 1;
+}
+
+void TaskGraph::AddEdge(NodeId from, NodeId to) {
+	DCHECK(!running_);
+	DCHECK_LT(from, nodes_.size());
+	DCHECK_LT(to, nodes_.size());
+	DCHECK_NE(from, to);
+	nodes_[from].successors.push_back(to);
+	nodes_[to].dependency_count++;
+	prepared_ = false;
+}
+
+void TaskGraph::Run(ThreadPool* pool) {
+	DCHECK(pool);
+	if (nodes_.empty())
+		return;
+
+	DCHECK(!running_);
+	running_.store(true, std::memory_order_relaxed);
+
+	if (!prepared_)
+		Prepare();
+
+	for (std::size_t i = 0; i < nodes_.size(); ++i) {
+		pending_[i].store(nodes_[i].dependency_count,
+						  std::memory_order_relaxed);
+	}
+	failed_.store(false, std::memory_order_relaxed);
+	exception_ = nullptr;
+	remaining_.Reset(nodes_.size());
+
+	for (NodeId root : roots_)
+		PostNode(pool, root);
+
+	remaining_.Wait(pool);
+
+	running_.store(false, std::memory_order_relaxed);
+	if (exception_)
+		std::rethrow_exception(exception_);
+}
+
+void TaskGraph::Prepare() {
+	// 环上的节点永远不会就绪, Run()会一直等下去, 所以release版本也要检查.
+	// 只有图被修改过以后才会重新检查.
+	CHECK(IsAcyclic());
+	pending_.reset(new std::atomic<std::size_t>[nodes_.size()]);
+	roots_.clear();
+	for (std::size_t i = 0; i < nodes_.size(); ++i) {
+		if (nodes_[i].dependency_count == 0)
+			roots_.push_back(i);
+	}
+	prepared_ = true;
+}
+
+void TaskGraph::PostNode(ThreadPool* pool, NodeId id) {
+	// 只捕获了两个指针和一个整数, 会直接保存在FunctionWrapper内部，不会有堆分配.
+	pool->PostTask([this, pool, id]() { RunNode(pool, id); });
+}
+
+void TaskGraph::RunNode(ThreadPool* pool, NodeId id) {
+	Node& node = nodes_[id];
+	if (!failed_.load(std::memory_order_relaxed)) {
+		try {
+			node.task.Run();
+		}
+		catch (...) {
+			std::lock_guard<std::mutex> lock(exception_lock_);
+			if (!exception_)
+				exception_ = std::current_exception();
+			failed_.store(true, std::memory_order_relaxed);
+		}
+	}
+
+	for (NodeId successor : node.successors) {
+		if (pending_[successor].fetch_sub(1, std::memory_order_acq_rel) == 1)
+			PostNode(pool, successor);
+	}
+
+	// 这必须是最后一次访问|this|, Done()返回以后Run()就可能返回, 图可能被析构.
+	remaining_.Done();
+}
+
+bool TaskGraph::IsAcyclic() const {
+	// Kahn算法, 能够按拓扑序访问到所有节点就说明没有环.
+	std::vector<std::size_t> in_degree(nodes_.size());
+	std::vector<NodeId> ready;
+	for (std::size_t i = 0; i < nodes_.size(); ++i) {
+		in_degree[i] = nodes_[i].dependency_count;
+		if (in_degree[i] == 0)
+			ready.push_back(i);
+	}
+
+	std::size_t visited = 0;
+	while (!ready.empty()) {
+		const NodeId id = ready.back();
+		ready.pop_back();
+		++visited;
+		for (NodeId successor : nodes_[id].successors) {
+			if (--in_degree[successor] == 0)
+				ready.push_back(successor);
+		}
+	}
+	return visited == nodes_.size();
+}
+
+}	// namespace base.
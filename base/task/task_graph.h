@@ -0,0 +1,107 @@
+﻿/**
+* @Author: YangGuang
+* @Date:   2026-10-17
+* @Email:  guang334419520@126.com
+* @Filename: task_graph.h
+* @Last modified by:  YangGuang
+*/
+#ifndef BASE_TASK_TASK_GRAPH_H
+#define BASE_TASK_TASK_GRAPH_H
+
+#include <stddef.h>
+
+#include <atomic>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "base/base_export.h"
+#include "base/callback.h"
+#include "base/macor.h"
+#include "base/task/helping_wait.h"
+
+namespace base {
+
+class ThreadPool;
+
+// 一个在ThreadPool上执行的任务依赖图(DAG). 节点和边只需要建立一次，之后可以
+// 反复的Run().
+//
+// 一个节点的所有前驱都执行完以后, 最后一个完成的前驱所在的工作线程会把它提交到
+// 自己的work-stealing队列里面, 所以后继节点一般会在同一个线程上执行，可以用到前驱
+// 留在cache里面的数据, 空闲的线程再把多出来的节点偷走.
+//
+// Sample usage:
+//   base::TaskGraph graph;
+//   auto load = graph.AddNode(base::Closure(&Load));
+//   auto parse_a = graph.AddNode(base::Closure(&ParseA));
+//   auto parse_b = graph.AddNode(base::Closure(&ParseB));
+//   auto merge = graph.AddNode(base::Closure(&Merge));
+//   graph.AddEdge(load, parse_a);
+//   graph.AddEdge(load, parse_b);
+//   graph.AddEdge(parse_a, merge);
+//   graph.AddEdge(parse_b, merge);
+//
+//   graph.Run(pool);   // 可以多次调用.
+//
+// Run()的调用线程会帮助执行线程池里面的任务(见internal::HelpingWait()), 所以
+// 在工作线程上调用也不会死锁, 没有任务可以执行的时候才睡眠. 同一个图不能同时
+// Run()两次.
+class BASE_EXPORT TaskGraph {
+ public:
+	 using NodeId = std::size_t;
+
+	 TaskGraph();
+	 ~TaskGraph();
+
+	 // 添加一个节点，返回它的id.
+	 NodeId AddNode(Closure task);
+
+	 // |to| 必须在 |from| 执行完以后才能执行.
+	 void AddEdge(NodeId from, NodeId to);
+
+	 // 执行整个图，所有的节点都执行完以后才返回. 如果有节点抛出了异常, 还没有开始的
+	 // 节点都不会再执行，第一个异常会在这里重新抛出. 图里面有环的时候直接CHECK
+	 // 失败.
+	 void Run(ThreadPool* pool);
+
+	 std::size_t node_count() const { return nodes_.size(); }
+
+ private:
+	 struct Node {
+		 Closure task;
+		 std::vector<NodeId> successors;
+		 // 前驱的数量, 每次Run()的时候用它重置|pending_|.
+		 std::size_t dependency_count = 0;
+	 };
+
+	 // 第一次Run()或者图被修改过以后, 重新分配|pending_|.
+	 void Prepare();
+
+	 void PostNode(ThreadPool* pool, NodeId id);
+
+	 void RunNode(ThreadPool* pool, NodeId id);
+
+	 bool IsAcyclic() const;
+
+	 std::vector<Node> nodes_;
+	 std::vector<NodeId> roots_;
+	 bool prepared_ = false;
+
+	 // 每一个节点还没有完成的前驱的数量.
+	 std::unique_ptr<std::atomic<std::size_t>[]> pending_;
+	 // 这次Run()还没有完成的节点数量.
+	 internal::JoinCount remaining_;
+	 std::atomic<bool> running_;
+
+	 std::atomic<bool> failed_;
+	 std::mutex exception_lock_;
+	 std::exception_ptr exception_;
+
+	 DISALLOW_COPY_AND_ASSIGN(TaskGraph);
+};
+
+}	// namespace base.
+
+#endif // !BASE_TASK_TASK_GRAPH_H
@@ -39,8 +39,17 @@ bool PostTaskAndReplyTaskRunner::PostTask(const Location& from_here,
 
 
 bool TaskRunner::PostTask(const Location & from_here, OnceClosure task) {
-	return PostDelayedTask(from_here, std::move(task),
-						   std::chrono::milliseconds(0));
+	return PostDelayedTask(from_here, std::move(task), TimeDelta());
+}
+
+bool TaskRunner::PostTasks(const Location& from_here,
+						   std::vector<OnceClosure> tasks) {
+	bool all_posted = true;
+	for (auto& task : tasks) {
+		if (!PostTask(from_here, std::move(task)))
+			all_posted = false;
+	}
+	return all_posted;
 }
 
 bool TaskRunner::PostTaskAndReplay(const Location & from_here,
@@ -10,18 +10,25 @@
 
 #include <stddef.h>
 
-#include <chrono>
+#include <vector>
 
 #include "base/base_export.h"
 #include "base/macor.h"
 #include "base/callback.h"
 #include "base/location.h"
+#include "base/time/time.h"
 
 namespace base {
 
 struct TaskRunnerTraits;
 struct DefaultDestroyTraits;
 
+#if defined(__cpp_impl_coroutine)
+namespace internal {
+class TaskRunnerAwaiter;
+}	// namespace internal.
+#endif
+
 // 一个TaskRunner对象是一个用来运行posted task的对象，TaskRunner提供了
 // 一个可以运行每一个task的方法, TaskRunner 提供一个非常weak的保证，在
 // 什么时候这个task运行，
@@ -56,12 +63,26 @@ class BASE_EXPORT TaskRunner {
      bool PostTask(const Location& from_here,
 				   OnceClosure Task);
     
+	 // 一次Post一批任务, 所有的任务都成功post返回true. 默认的实现是逐个调用
+	 // PostTask(), 能够一次加入一批任务的TaskRunner应该重载它，这样整批任务只
+	 // 需要一次同步和一次唤醒.
+	 virtual bool PostTasks(const Location& from_here,
+							std::vector<OnceClosure> tasks);
+
 	 // 这个像PostTask一样，但是通过这个函数posted的task只会在延迟delay时间，
-	 // 才会运行
+	 // 才会运行. |delay|精确到微秒, 也可以直接传std::chrono的时间长度.
      virtual bool PostDelayedTask(const Location& from_here,
 								  OnceClosure Task,
-                                  std::chrono::milliseconds delay) = 0;
+                                  TimeDelta delay) = 0;
                                  
+#if defined(__cpp_impl_coroutine)
+	 // 在协程里面 co_await task_runner->Schedule() 切换到这个TaskRunner上继续
+	 // 执行, ScheduleAfter()延迟|delay|以后再继续. 需要include
+	 // "base/task/coroutine.h".
+	 internal::TaskRunnerAwaiter Schedule();
+	 internal::TaskRunnerAwaiter ScheduleAfter(TimeDelta delay);
+#endif
+
 	 // 如果返回true，代表实在当前序列，或者说是绑定到的当前线程. 
      virtual bool RunsTasksInCurrentSequence() = 0;
 
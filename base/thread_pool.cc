@@ -8,31 +8,67 @@
 
 #include "base/threading/thread_pool.h"
 
+#include <algorithm>
 #include <exception>
+#include <system_error>
 
 //#include "base/logging.h"
 #include <glog/logging.h>
 
+#include "base/threading/cpu_topology.h"
+
 namespace {
 
-base::ThreadPool* g_instance = nullptr;
+// 默认的线程池, 给不在工作线程上调用的Current()使用.
+std::atomic<base::ThreadPool*> g_default_pool(nullptr);
 
 }
 
 namespace base {
 
-thread_local internal::WorkStaealinggQueue*
-	ThreadPool::local_work_queue_ = nullptr;
-thread_local unsigned int ThreadPool::index_ = 0;
+thread_local ThreadPool::WorkerContext ThreadPool::worker_context_ = {
+	nullptr, nullptr, 0, 0 };
+
+namespace internal {
+
+ThreadPool* GetCurrentWorkerThreadPool() {
+	return ThreadPool::CurrentWorkerPool();
+}
+
+bool RunPendingTaskOnThreadPool(ThreadPool* pool) {
+	return pool->RunPendingTask();
+}
+
+}	// namespace internal.
 
 ThreadPool * ThreadPool::Current() {
-	return g_instance;
+	if (worker_context_.pool)
+		return worker_context_.pool;
+	return g_default_pool.load(std::memory_order_acquire);
 }
 
+ThreadPool::Options::Options(std::size_t thread_num)
+	: min_threads(thread_num),
+	  max_threads(thread_num * 4),
+	  idle_timeout(std::chrono::seconds(10)) {}
+
 ThreadPool::ThreadPool(std::size_t thread_num)
-	: thread_num_(thread_num){
-	DCHECK(!g_instance);
-	g_instance = this;
+	: ThreadPool(Options(thread_num)) {}
+
+ThreadPool::ThreadPool(const Options& options)
+	: thread_num_(options.min_threads),
+	  max_threads_(std::max(options.min_threads, options.max_threads)),
+	  idle_timeout_(options.idle_timeout),
+	  pin_threads_(options.pin_threads),
+	  steal_half_(options.steal_half),
+	  metrics_enabled_(options.enable_metrics),
+	  metrics_(new internal::WorkerMetricsRecorder[max_threads_ + 1]),
+	  live_workers_(0),
+	  blocked_workers_(0),
+	  remote_steals_(0) {
+	ThreadPool* expected = nullptr;
+	g_default_pool.compare_exchange_strong(expected, this,
+										   std::memory_order_acq_rel);
 }
 
 void ThreadPool::Start() {
@@ -41,60 +77,303 @@ void ThreadPool::Start() {
 	DCHECK(!running_);
 	running_ = true;
 	
-	try {
-		for (unsigned int i = 0; i < thread_num_; i++) {
-			queues_.push_back(std::unique_ptr<internal::WorkStaealinggQueue>(
-				new internal::WorkStaealinggQueue));
-			threads_.push_back(
-				std::thread(&ThreadPool::WorkerThread, this, i));
-		}
+	// 先把所有队列的位置都分配好再启动线程, 这样工作线程开始偷取任务的时候
+	// |queues_|已经不会再改变了. 临时增加的线程也要用到队列，所以按照
+	// |max_threads_|分配. 队列本身由工作线程自己创建.
+	queues_.reset(new std::atomic<internal::WorkStaealinggQueue*>[max_threads_]);
+	for (unsigned int i = 0; i < max_threads_; i++)
+		queues_[i].store(nullptr, std::memory_order_relaxed);
+	BuildStealOrder();
 
-		cond_var_queues_.notify_all();
+	std::unique_lock<std::mutex> lock(workers_lock_);
+	threads_.resize(max_threads_);
+	slot_in_use_.assign(max_threads_, false);
+	try {
+		for (unsigned int i = 0; i < thread_num_; i++)
+			StartWorkerLocked(i);
 	}
 	catch (...) {
-		cond_var_queues_.notify_all();
 		running_ = false;
+		idle_workers_.NotifyAll();
+		for (auto& thread : threads_) {
+			if (thread.joinable())
+				thread.join();
+		}
+		threads_.clear();
+		slot_in_use_.clear();
+		live_workers_ = 0;
 		throw std::runtime_error("Start failed");
 	}
 }
 
-void ThreadPool::RunPendingTask() {
+void ThreadPool::BuildStealOrder() {
+	const std::vector<CpuTopology::Cpu>& cpus = CpuTopology::Get().cpus();
+	worker_cpus_.assign(max_threads_, -1);
+	steal_order_.assign(max_threads_, std::vector<Victim>());
+	steal_tier_ends_.assign(max_threads_, std::vector<std::size_t>());
+
+	for (unsigned int i = 0; i < max_threads_; ++i) {
+		if (pin_threads_)
+			worker_cpus_[i] = cpus[i % cpus.size()].id;
+	}
+
+	// 没有绑定CPU的时候线程可能在任何地方运行, 只能简单的从下一个线程开始轮流偷.
+	auto distance = [&](unsigned int thief, unsigned int victim) {
+		if (!pin_threads_)
+			return 0;
+		const CpuTopology::Cpu& a = cpus[thief % cpus.size()];
+		const CpuTopology::Cpu& b = cpus[victim % cpus.size()];
+		if (a.cache_id == b.cache_id && a.node_id == b.node_id)
+			return 0;
+		return a.node_id == b.node_id ? 1 : 2;
+	};
+
+	for (unsigned int i = 0; i < max_threads_; ++i) {
+		std::vector<Victim>& order = steal_order_[i];
+		for (unsigned int step = 1; step < max_threads_; ++step) {
+			const unsigned int victim = (i + step) % max_threads_;
+			order.push_back(Victim{ victim, distance(i, victim) == 2 });
+		}
+		std::stable_sort(order.begin(), order.end(),
+			[&](const Victim& a, const Victim& b) {
+				return distance(i, a.index) < distance(i, b.index);
+			});
+
+		std::vector<std::size_t>& tier_ends = steal_tier_ends_[i];
+		for (std::size_t pos = 1; pos <= order.size(); ++pos) {
+			if (pos == order.size() ||
+				distance(i, order[pos].index) != distance(i, order[pos - 1].index)) {
+				tier_ends.push_back(pos);
+			}
+		}
+	}
+}
+
+uint32_t ThreadPool::NextRandom() {
+	uint32_t x = worker_context_.rng_state;
+	if (x == 0) {
+		x = static_cast<uint32_t>(
+			std::hash<std::thread::id>()(std::this_thread::get_id())) | 1;
+	}
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	worker_context_.rng_state = x;
+	return x;
+}
+
+bool ThreadPool::PopTaskFromOtherThreadQueue(Task& task) {
+	// 不是工作线程(比如在RunPendingTask()里面帮忙的线程), 没有自己的位置.
+	if (!LocalQueue()) {
+		const unsigned int start = NextRandom() % max_threads_;
+		for (unsigned int i = 0; i < max_threads_; ++i) {
+			if (TryStealFrom((start + i) % max_threads_, task)) {
+				if (metrics_enabled()) {
+					CurrentMetrics().stolen_tasks.fetch_add(
+						1, std::memory_order_relaxed);
+				}
+				return true;
+			}
+		}
+		if (metrics_enabled())
+			CurrentMetrics().failed_steals.fetch_add(1, std::memory_order_relaxed);
+		return false;
+	}
+
+	// 按照距离一层一层的偷, 每一层里面从随机的位置开始.
+	const std::vector<Victim>& order = steal_order_[worker_context_.index];
+	std::size_t tier_begin = 0;
+	for (std::size_t tier_end : steal_tier_ends_[worker_context_.index]) {
+		const std::size_t tier_size = tier_end - tier_begin;
+		const std::size_t start = NextRandom() % tier_size;
+		for (std::size_t i = 0; i < tier_size; ++i) {
+			const Victim& victim = order[tier_begin + (start + i) % tier_size];
+			if (TryStealFrom(victim.index, task)) {
+				if (victim.remote)
+					remote_steals_.fetch_add(1, std::memory_order_relaxed);
+				if (metrics_enabled()) {
+					CurrentMetrics().stolen_tasks.fetch_add(
+						1, std::memory_order_relaxed);
+				}
+				return true;
+			}
+		}
+		tier_begin = tier_end;
+	}
+	if (metrics_enabled())
+		CurrentMetrics().failed_steals.fetch_add(1, std::memory_order_relaxed);
+	return false;
+}
+
+bool ThreadPool::PopTaskFromPoolQueue(Task& task) {
+	PoolTask pool_task;
+	if (!pool_work_queue_.TryPop(pool_task))
+		return false;
+
+	task = std::move(pool_task.task);
+	if (metrics_enabled()) {
+		internal::WorkerMetricsRecorder& metrics = CurrentMetrics();
+		metrics.pool_tasks.fetch_add(1, std::memory_order_relaxed);
+		// 打开统计之前提交的任务没有时间.
+		if (pool_task.posted_at != 0) {
+			const int64_t now = internal::MetricsNowNanoseconds();
+			metrics.queue_wait.Record(
+				static_cast<uint64_t>(std::max<int64_t>(0, now - pool_task.posted_at)));
+		}
+	}
+	return true;
+}
+
+void ThreadPool::PushPoolTaskBatch(std::vector<Task>& tasks) {
+	const int64_t posted_at = PostTime();
+	std::vector<PoolTask> pool_tasks;
+	pool_tasks.reserve(tasks.size());
+	for (Task& task : tasks)
+		pool_tasks.push_back(PoolTask{ std::move(task), posted_at });
+	pool_work_queue_.PushBatch(pool_tasks.data(), pool_tasks.size());
+}
+
+void ThreadPool::RunTask(Task& task) {
+	if (!metrics_enabled()) {
+		task();
+		return;
+	}
+
+	// 先拿到计数器, 任务里面可能会改变当前线程的状态(比如ScopedBlockingCall).
+	internal::WorkerMetricsRecorder& metrics = CurrentMetrics();
+	const int64_t start = internal::MetricsNowNanoseconds();
+	task();
+	const int64_t end = internal::MetricsNowNanoseconds();
+	metrics.run_time.Record(static_cast<uint64_t>(std::max<int64_t>(0, end - start)));
+	metrics.tasks_run.fetch_add(1, std::memory_order_relaxed);
+}
+
+ThreadPoolMetrics ThreadPool::GetMetrics() const {
+	ThreadPoolMetrics result;
+	result.pool_queue_depth = pool_work_queue_.ApproximateSize();
+	result.workers.resize(max_threads_ + 1);
+	for (unsigned int i = 0; i <= max_threads_; ++i) {
+		ThreadPoolMetrics::Worker& worker = result.workers[i];
+		metrics_[i].Snapshot(&worker);
+		if (i == max_threads_)
+			continue;
+		worker.index = static_cast<int>(i);
+		// |queues_|只有在Start()和JoinAll()之间才存在.
+		if (running_ && queues_) {
+			if (internal::WorkStaealinggQueue* queue =
+					queues_[i].load(std::memory_order_acquire)) {
+				worker.queue_depth = queue->ApproximateSize();
+			}
+		}
+	}
+	return result;
+}
+
+void ThreadPool::StartWorkerLocked(unsigned int index) {
+	DCHECK(!slot_in_use_[index]);
+	// 之前使用这个位置的临时线程已经退出了，只是还没有join.
+	if (threads_[index].joinable())
+		threads_[index].join();
+
+	threads_[index] = std::thread(&ThreadPool::WorkerThread, this, index);
+	slot_in_use_[index] = true;
+	live_workers_.fetch_add(1, std::memory_order_relaxed);
+}
+
+void ThreadPool::BlockingStarted() {
+	blocked_workers_.fetch_add(1, std::memory_order_relaxed);
+	MaybeAddWorker();
+}
+
+void ThreadPool::BlockingEnded() {
+	// 多出来的线程不在这里回收，等它们空闲超时以后自己退出, 这样连续的阻塞调用
+	// 不会反复的创建线程.
+	blocked_workers_.fetch_sub(1, std::memory_order_relaxed);
+}
+
+void ThreadPool::MaybeAddWorker() {
+	std::lock_guard<std::mutex> lock(workers_lock_);
+	if (!running_)
+		return;
+
+	const std::size_t live = live_workers_.load(std::memory_order_relaxed);
+	const std::size_t blocked = blocked_workers_.load(std::memory_order_relaxed);
+	if (live - blocked >= thread_num_ || live >= max_threads_)
+		return;
+
+	for (unsigned int i = static_cast<unsigned int>(thread_num_);
+		 i < max_threads_; ++i) {
+		if (slot_in_use_[i])
+			continue;
+		try {
+			StartWorkerLocked(i);
+		}
+		catch (const std::system_error&) {
+			// 创建线程失败只是少了一个顶替的线程, 不影响正确性.
+		}
+		return;
+	}
+}
+
+bool ThreadPool::MaybeRetireWorker(unsigned int index) {
+	DCHECK_GE(index, thread_num_);
+	std::lock_guard<std::mutex> lock(workers_lock_);
+	if (!running_)
+		return true;
+
+	const std::size_t live = live_workers_.load(std::memory_order_relaxed);
+	const std::size_t blocked = blocked_workers_.load(std::memory_order_relaxed);
+	// 还有线程在阻塞，需要我们顶替.
+	if (live - blocked <= thread_num_)
+		return false;
+
+	slot_in_use_[index] = false;
+	live_workers_.fetch_sub(1, std::memory_order_relaxed);
+	return true;
+}
+
+bool ThreadPool::RunPendingTask() {
 	Task task;
 	// 有三种从队列中去任务的方式，首先会尝试从自己的队列中取队列,如果没有, 会尝试去
 	// 共享的队列取数据，还是没有，就会从友军线程取偷取任务执行，友军线程也没有哪就是
 	// 没有任务可执行，就休息一会.
-	if (PopTaskFromLocalQueue(task) ||
-		PopTaskFromPoolQueue(task) ||
-		PopTaskFromOtherThreadQueue(task)) {
-		task();
-	}
-	else {
-		std::this_thread::yield();
+	if (PopPendingTask(task)) {
+		RunTask(task);
+		return true;
 	}
+	std::this_thread::yield();
+	return false;
 }
 
 void ThreadPool::JoinAll() {
 	DCHECK(running_);
 	running_ = false;
-	for (auto it = threads_.begin(); it != threads_.end(); ++it) {
+	idle_workers_.NotifyAll();
+
+	// 不能拿着|workers_lock_| join, 正在退出的临时线程可能在等这个锁.
+	std::vector<std::thread> threads;
+	{
+		std::lock_guard<std::mutex> lock(workers_lock_);
+		threads.swap(threads_);
+		slot_in_use_.clear();
+	}
+	for (auto it = threads.begin(); it != threads.end(); ++it) {
 		if (it->joinable()) {
 			it->join();
 		}
 	}
+	live_workers_ = 0;
 
-	for (auto& queue : queues_) {
-		queue.reset();
-	}
-
-	queues_.swap(std::vector<std::unique_ptr<internal::WorkStaealinggQueue>>());
+	for (unsigned int i = 0; i < max_threads_; i++)
+		delete queues_[i].exchange(nullptr, std::memory_order_relaxed);
+	queues_.reset();
 	pool_work_queue_.Clear();
-	threads_.swap(std::vector<std::thread>());
 }
 
 ThreadPool::~ThreadPool() {
-	DCHECK(g_instance);
 	if (running_) {
 		running_ = false;
+		idle_workers_.NotifyAll();
 	}
 	else if (!threads_.empty()){
 		for (auto it = threads_.begin(); it != threads_.end(); ++it) {
@@ -104,24 +383,70 @@ ThreadPool::~ThreadPool() {
 		}
 	}
 	
-	g_instance = nullptr;
+	ThreadPool* expected = this;
+	g_default_pool.compare_exchange_strong(expected, nullptr,
+										   std::memory_order_acq_rel);
 }
 
 void ThreadPool::WorkerThread(unsigned int index) {
-	// 等待Start函数完成
-	{
-		std::mutex mutex;
-		std::unique_lock<std::mutex> lock(mutex);
-		cond_var_queues_.wait(lock);
-	}
-	
+	DCHECK(!worker_context_.pool);
+	if (worker_cpus_[index] >= 0)
+		CpuTopology::PinCurrentThreadToCpu(worker_cpus_[index]);
 
-	index_ = index;
-	local_work_queue_ = queues_[index_].get();
+	// 绑定CPU以后再创建队列(first touch), 之前在这个位置退出的临时线程留下的队列
+	// 直接复用.
+	internal::WorkStaealinggQueue* queue =
+		queues_[index].load(std::memory_order_acquire);
+	if (!queue) {
+		queue = new internal::WorkStaealinggQueue;
+		queues_[index].store(queue, std::memory_order_release);
+	}
+	worker_context_.pool = this;
+	worker_context_.queue = queue;
+	worker_context_.index = index;
+	worker_context_.rng_state = (index + 1) * 0x9E3779B9u;
 
+	// 找不到任务的时候先自旋一小会儿，还是没有任务就在|idle_workers_|上睡眠,
+	// 直到AddWork()把我们唤醒，这样空闲的线程池不会占用cpu.
+	int spin_rounds = 0;
 	while (running_) {
-		RunPendingTask();
+		Task task;
+		if (PopPendingTask(task)) {
+			RunTask(task);
+			spin_rounds = 0;
+			continue;
+		}
+
+		if (++spin_rounds < kSpinRounds) {
+			std::this_thread::yield();
+			continue;
+		}
+		spin_rounds = 0;
+
+		EventCount::Key key = idle_workers_.PrepareWait();
+		// PrepareWait()之后必须再检查一次，否则可能错过在这之间加入的任务.
+		if (PopPendingTask(task)) {
+			idle_workers_.CancelWait();
+			RunTask(task);
+			continue;
+		}
+		if (!running_) {
+			idle_workers_.CancelWait();
+			break;
+		}
+		if (index < thread_num_) {
+			idle_workers_.Wait(key);
+		}
+		else if (!idle_workers_.WaitFor(key, idle_timeout_) &&
+				 MaybeRetireWorker(index)) {
+			// 临时的线程空闲超时，并且没有阻塞的线程需要顶替, 退出.
+			// 自己的队列一定是空的, 只有我们自己会往里面Push.
+			break;
+		}
 	}
+
+	worker_context_.pool = nullptr;
+	worker_context_.queue = nullptr;
 }
 
 }	// namespace base.
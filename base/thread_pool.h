@@ -9,96 +9,392 @@
 #ifndef BASE_THREADING_THREAD_POOL_H
 #define BASE_THREADING_THREAD_POOL_H
 
+#include <algorithm>
 #include <vector>
 #include <future>
 #include <thread>
 #include <atomic>
+#include <chrono>
+#include <cstdint>
 #include <memory>
+#include <mutex>
 #include <functional>
-#include <condition_variable>
+#include <type_traits>
 
 
 #include "base/base_export.h"
-#include "base/thread_safe_queue.h"
+#include "base/callback.h"
+#include "base/mpmc_queue.h"
 #include "base/task/function_wrapper.h"
+#include "base/task/future.h"
+#include "base/task/helping_wait.h"
+#include "base/threading/event_count.h"
+#include "base/threading/thread_pool_metrics.h"
 #include "base/work_stealing_queue.h"
 
 namespace base {
 
+class ScopedBlockingCall;
+
+#if defined(__cpp_impl_coroutine)
+namespace internal {
+class ThreadPoolAwaiter;
+}	// namespace internal.
+#endif
+
 class BASE_EXPORT ThreadPool {
  public:
+	// 线程池平时保持|min_threads|个工作线程. 有工作线程进入ScopedBlockingCall
+	// 的时候, 会临时增加线程来顶替它, 但是总数不超过|max_threads|. 多出来的线程
+	// 空闲|idle_timeout|以后，如果不再需要就会退出.
+	struct BASE_EXPORT Options {
+		explicit Options(std::size_t thread_num =
+							 std::thread::hardware_concurrency());
+
+		std::size_t min_threads;
+		std::size_t max_threads;
+		std::chrono::milliseconds idle_timeout;
+		// 把第i个工作线程绑定到CpuTopology::cpus()里面的第i个CPU上(超过CPU
+		// 数量的时候循环使用). 只有绑定了线程, 偷取的时候才会按照拓扑选择顺序.
+		bool pin_threads = false;
+		// 偷取成功以后，把受害者队列里剩下任务的一半也一起搬到自己的队列里, 这样
+		// 负载很不均衡的时候(比如一棵很偏的递归树), 偷取者不用每执行一个小任务就
+		// 回来偷一次.
+		bool steal_half = false;
+		// 是否一开始就记录ThreadPoolMetrics, 之后可以用SetMetricsEnabled()修改.
+		bool enable_metrics = false;
+	};
+
+	// 在工作线程上调用返回这个工作线程所属的线程池, 在其他线程上调用返回默认的
+	// 线程池(第一个创建的、还没有析构的线程池), 可以同时存在多个线程池.
 	static ThreadPool* Current();
 
 	explicit ThreadPool(std::size_t thread_num = 
 						std::thread::hardware_concurrency());
 
+	explicit ThreadPool(const Options& options);
+
 	void Start();
 
-	void RunPendingTask();
+	// 尝试运行一个任务，如果没有找到任务就让出cpu并且返回false. 工作线程以外的
+	// 线程也可以调用这个函数来帮助线程池执行任务.
+	bool RunPendingTask();
 
 	void JoinAll();
 
+	// 等待|future|完成, 等待的时候执行这个线程池里面的任务而不是阻塞. 工作线程
+	// 等待同一个线程池里面的任务的结果时必须使用这个, 否则可能死锁.
+	template <typename T>
+	void WaitFor(Future<T>& future) { future.Wait(this); }
+
+	// 和上面一样, 但是找不到任务的时候只能在future.wait_for()上睡眠一会儿.
+	template <typename T>
+	void WaitFor(const std::future<T>& future) {
+		internal::StdFutureWaitable<T> waitable(future);
+		internal::HelpingWait(this, &waitable);
+	}
+
+	// 提交一个任务, 返回的Future可以用Then()/WhenAll()继续组合, 不需要阻塞
+	// 任何线程.
 	template <typename Function>
 	auto AddWork(Function f)
-		->std::future<typename std::result_of<Function()>::type>;
+		->Future<std::invoke_result_t<Function>>;
+
+	// 提交一个不需要返回值的任务. 和AddWork()不一样，这里不会创建Promise和
+	// Future, 小的lambda会直接保存在FunctionWrapper内部，整个提交过程没有堆分配.
+	template <typename Function>
+	void PostTask(Function&& f);
+
+	void PostTask(OnceClosure task);
+
+	// 一次提交一批任务. 整批任务只需要一次同步就能加入队列(工作线程上是一次
+	// 发布bottom, 其他线程是一次CAS或者一次加锁), 并且按照任务的数量唤醒空闲的
+	// 工作线程, 而不是每一个任务唤醒一次.
+	template <typename Function>
+	auto AddWorkBatch(std::vector<Function> functions)
+		->std::vector<Future<std::invoke_result_t<Function>>>;
+
+	void PostTasks(std::vector<OnceClosure> tasks);
+
+#if defined(__cpp_impl_coroutine)
+	// 在协程里面 co_await pool->Schedule() 切换到线程池的工作线程上继续执行.
+	// 需要include "base/task/coroutine.h".
+	internal::ThreadPoolAwaiter Schedule();
+#endif
+
+	std::size_t thread_num() const { return thread_num_; }
+
+	// 当前活着的工作线程数量, 包括正在阻塞的线程和临时增加的线程.
+	std::size_t live_thread_num() const {
+		return live_workers_.load(std::memory_order_relaxed);
+	}
+
+	// 从其他NUMA节点上的工作线程偷到任务的次数.
+	uint64_t remote_steal_count() const {
+		return remote_steals_.load(std::memory_order_relaxed);
+	}
+
+	// 打开或者关闭统计. 关闭的时候每个任务只多一次relaxed load, 不会读取时钟.
+	void SetMetricsEnabled(bool enabled) {
+		metrics_enabled_.store(enabled, std::memory_order_relaxed);
+	}
+
+	bool metrics_enabled() const {
+		return metrics_enabled_.load(std::memory_order_relaxed);
+	}
+
+	// 可以在任意线程调用(但是不能和JoinAll()同时调用), 只读取原子计数器，不会
+	// 阻塞工作线程. 不同的计数器之间不保证是同一时刻的值.
+	ThreadPoolMetrics GetMetrics() const;
+
+	// 如果调用线程不是工作线程，或者它自己的队列里面没有任务，返回true.
+	bool LocalQueueIsEmpty() const {
+		internal::WorkStaealinggQueue* queue = LocalQueue();
+		return !queue || queue->Empty();
+	}
 
 	~ThreadPool();
 
  private:
+	 friend class ScopedBlockingCall;
+	 friend ThreadPool* internal::GetCurrentWorkerThreadPool();
+
 	 using Task = base::FunctionWrapper;
+
+	 // |pool_work_queue_|里面的任务, 打开统计的时候带上提交的时间, 否则为0.
+	 struct PoolTask {
+		 Task task;
+		 int64_t posted_at;
+	 };
+
+	 // 工作线程找不到任务时，先自旋这么多轮再去睡眠.
+	 static constexpr int kSpinRounds = 64;
+
 	 void WorkerThread(unsigned int index);
+
+	 // 调用线程所属的线程池, 不是工作线程返回nullptr.
+	 static ThreadPool* CurrentWorkerPool() { return worker_context_.pool; }
+
+	 // 调用线程是这个线程池的工作线程的话，返回它自己的队列, 否则返回nullptr.
+	 // 其他线程池的工作线程提交到这个线程池的任务会走|pool_work_queue_|.
+	 internal::WorkStaealinggQueue* LocalQueue() const {
+		 return worker_context_.pool == this ? worker_context_.queue : nullptr;
+	 }
+
+	 // ScopedBlockingCall 调用, 标记当前工作线程开始/结束阻塞.
+	 void BlockingStarted();
+	 void BlockingEnded();
+
+	 // 如果没有阻塞的工作线程少于|thread_num_|, 增加一个临时的工作线程.
+	 void MaybeAddWorker();
+
+	 // 临时的工作线程空闲超时以后调用，返回true表示这个线程应该退出.
+	 bool MaybeRetireWorker(unsigned int index);
+
+	 // 在|index|这个位置启动一个工作线程, 必须持有|workers_lock_|.
+	 void StartWorkerLocked(unsigned int index);
+
+	 // 按照 local queue -> pool queue -> 偷取 的顺序取出一个任务.
+	 bool PopPendingTask(Task& task) {
+		 return PopTaskFromLocalQueue(task) ||
+			 PopTaskFromPoolQueue(task) ||
+			 PopTaskFromOtherThreadQueue(task);
+	 }
+
+	 // 工作线程提交的任务放到自己的队列，其他线程放到|pool_work_queue_|.
+	 void PushTask(Task task) {
+		 if (internal::WorkStaealinggQueue* queue = LocalQueue())
+			 queue->Push(std::move(task));
+		 else
+			 pool_work_queue_.Push(PoolTask{ std::move(task), PostTime() });
+
+		 WakeUpIdleWorker();
+	 }
+
+	 // |tasks|里面的任务会被移走.
+	 void PushTaskBatch(std::vector<Task>& tasks) {
+		 if (tasks.empty())
+			 return;
+
+		 if (internal::WorkStaealinggQueue* queue = LocalQueue())
+			 queue->PushBatch(tasks.data(), tasks.size());
+		 else
+			 PushPoolTaskBatch(tasks);
+
+		 // 一个任务最多需要一个线程, 没有必要唤醒比任务更多的线程.
+		 idle_workers_.Notify(static_cast<int>(
+			 std::min(tasks.size(), max_threads_)));
+	 }
+
+	 // 有任务加入队列之后调用, 只有在有工作线程睡眠的时候才会真正的去唤醒.
+	 void WakeUpIdleWorker() { idle_workers_.NotifyOne(); }
 	 bool PopTaskFromLocalQueue(Task& task) {
-		 return local_work_queue_ && local_work_queue_->TryPop(task);
+		 internal::WorkStaealinggQueue* queue = LocalQueue();
+		 if (!queue || !queue->TryPop(task))
+			 return false;
+		 if (metrics_enabled())
+			 CurrentMetrics().local_tasks.fetch_add(1, std::memory_order_relaxed);
+		 return true;
+	 }
+
+	 bool PopTaskFromPoolQueue(Task& task);
+
+	 void PushPoolTaskBatch(std::vector<Task>& tasks);
+
+	 int64_t PostTime() const {
+		 return metrics_enabled() ? internal::MetricsNowNanoseconds() : 0;
 	 }
 
-	 bool PopTaskFromPoolQueue(Task& task) {
-		 return pool_work_queue_.TryPop(task);
+	 // 执行一个任务，打开统计的时候记录执行时间.
+	 void RunTask(Task& task);
+
+	 // 调用线程的计数器, 非工作线程共用最后一个.
+	 internal::WorkerMetricsRecorder& CurrentMetrics() {
+		 return metrics_[LocalQueue() ? worker_context_.index : max_threads_];
 	 }
 
-	 bool PopTaskFromOtherThreadQueue(Task& task) {
-		 const std::size_t size = queues_.size();
-		 // 从index后面的线程队列开始偷取任务.
-		 for (unsigned int i = 0; i < size; ++i) {
-			 const unsigned int index = (index_ + i + 1) % size;
-			 if (queues_[index_]->TrySteal(task))
-				 return true;
-		 }
-		 return false;
+	 bool PopTaskFromOtherThreadQueue(Task& task);
+
+	 bool TryStealFrom(unsigned int index, Task& task) {
+		 internal::WorkStaealinggQueue* queue =
+			 queues_[index].load(std::memory_order_acquire);
+		 if (!queue)
+			 return false;
+		 internal::WorkStaealinggQueue* local = LocalQueue();
+		 if (steal_half_ && local && local != queue)
+			 return queue->StealHalfInto(local, task);
+		 return queue->TrySteal(task);
 	 }
 
+	 // 当前线程私有的xorshift32随机数, 用来随机选择偷取的起点.
+	 static uint32_t NextRandom();
+
+	 // 为每一个工作线程计算偷取的顺序.
+	 void BuildStealOrder();
+
 	 std::atomic_bool running_ = false;
-	 base::ThreadSafeQueue<Task> pool_work_queue_;
-	 std::vector<std::unique_ptr<internal::WorkStaealinggQueue>> queues_;
-	 std::condition_variable cond_var_queues_;
+	 // 非工作线程提交的任务都放到这个全局的无锁队列里面.
+	 base::MPMCQueue<PoolTask> pool_work_queue_;
+	 // 每一个工作线程的队列, 在工作线程自己的线程上第一次运行的时候创建, 这样
+	 // 队列的内存会分配在这个线程所在的NUMA节点上. 一共有|max_threads_|个.
+	 std::unique_ptr<std::atomic<internal::WorkStaealinggQueue*>[]> queues_;
+
+	 struct Victim {
+		 unsigned int index;
+		 // 和偷取者不在同一个NUMA节点上.
+		 bool remote;
+	 };
+	 // |steal_order_[i]|是第i个工作线程的偷取顺序: 先是共享同一个L3 cache的线程，
+	 // 然后是同一个节点上的，最后才是其他节点上的.
+	 std::vector<std::vector<Victim>> steal_order_;
+	 // |steal_tier_ends_[i]|是|steal_order_[i]|里面每一层(同一个cache, 同一个
+	 // 节点, 其他节点)的结束位置. 同一层里面的线程距离一样，每次从随机的位置开始
+	 // 偷，避免所有的偷取者同时盯着同一个受害者.
+	 std::vector<std::vector<std::size_t>> steal_tier_ends_;
+	 // 每一个工作线程绑定的CPU, 没有绑定的话是-1.
+	 std::vector<int> worker_cpus_;
 
+	 // 常驻的工作线程数量, 这些线程的index是[0, thread_num_).
 	 std::size_t thread_num_;
+	 // 临时增加的线程使用[thread_num_, max_threads_)之间空闲的index.
+	 std::size_t max_threads_;
+	 std::chrono::milliseconds idle_timeout_;
+	 bool pin_threads_;
+	 bool steal_half_;
+
+	 std::atomic_bool metrics_enabled_;
+	 // |max_threads_| + 1个, 最后一个给非工作线程. 必须声明在|max_threads_|
+	 // 后面, 构造的时候要用它计算大小.
+	 std::unique_ptr<internal::WorkerMetricsRecorder[]> metrics_;
+	 // 没有任务可以执行的工作线程在这上面睡眠.
+	 EventCount idle_workers_;
+
+	 std::atomic<std::size_t> live_workers_;
+	 std::atomic<std::size_t> blocked_workers_;
+	 // 从其他NUMA节点上偷到的任务数量.
+	 std::atomic<uint64_t> remote_steals_;
+
+	 // 保护|threads_| 和 |slot_in_use_|, 只有启动/退出线程的时候才会用到.
+	 std::mutex workers_lock_;
 	 std::vector<std::thread> threads_;
-	 static thread_local internal::WorkStaealinggQueue* local_work_queue_;
-	 static thread_local unsigned int index_;
+	 std::vector<bool> slot_in_use_;
+
+	 // 每一个线程最多是一个线程池的工作线程, 所有的线程池共用这一个thread_local,
+	 // 通过|pool|区分是不是自己的工作线程.
+	 struct WorkerContext {
+		 ThreadPool* pool;
+		 internal::WorkStaealinggQueue* queue;
+		 unsigned int index;
+		 // NextRandom()的状态, 为0表示还没有初始化.
+		 uint32_t rng_state;
+	 };
+	 static thread_local WorkerContext worker_context_;
 };
 
 
 
 template<typename Function>
 inline auto ThreadPool::AddWork(Function f) 
-	-> std::future<typename std::result_of<Function()>::type> {
-	typedef typename std::result_of<Function()>::type result_type;
-	std::packaged_task<result_type()> task(f);
-	std::future<result_type> res(task.get_future());
-
-	if (local_work_queue_)
-		local_work_queue_->Push(std::move(task));
-	else
-		pool_work_queue_.Push(std::move(task));
+	-> Future<std::invoke_result_t<Function>> {
+	typedef std::invoke_result_t<Function> result_type;
+	Promise<result_type> promise;
+	Future<result_type> res(promise.GetFuture());
 
+	PushTask(Task([promise = std::move(promise), f = std::move(f)]() mutable {
+		internal::PromiseFulfiller<result_type>::Run(promise, f);
+	}));
 	return res;
 }
 
+template <typename Function>
+inline auto ThreadPool::AddWorkBatch(std::vector<Function> functions)
+	->std::vector<Future<std::invoke_result_t<Function>>> {
+	typedef std::invoke_result_t<Function> result_type;
+	std::vector<Future<result_type>> results;
+	std::vector<Task> tasks;
+	results.reserve(functions.size());
+	tasks.reserve(functions.size());
+	for (auto& f : functions) {
+		Promise<result_type> promise;
+		results.push_back(promise.GetFuture());
+		tasks.push_back(Task(
+			[promise = std::move(promise), f = std::move(f)]() mutable {
+				internal::PromiseFulfiller<result_type>::Run(promise, f);
+			}));
+	}
+
+	PushTaskBatch(tasks);
+	return results;
+}
+
+template <typename Function>
+inline void ThreadPool::PostTask(Function&& f) {
+	PushTask(Task(std::forward<Function>(f)));
+}
+
+inline void ThreadPool::PostTask(OnceClosure task) {
+	PushTask(Task([task = std::move(task)]() mutable {
+		std::move(task).Run();
+	}));
+}
+
+inline void ThreadPool::PostTasks(std::vector<OnceClosure> tasks) {
+	std::vector<Task> wrapped;
+	wrapped.reserve(tasks.size());
+	for (auto& task : tasks) {
+		wrapped.push_back(Task([task = std::move(task)]() mutable {
+			std::move(task).Run();
+		}));
+	}
+	PushTaskBatch(wrapped);
+}
+
+// 参数直接捕获到lambda里面，不再经过std::bind.
 template <typename Fun, typename... Args>
 inline auto PostTaskToThreadPool(Fun f, Args... args)
-	->std::future<typename std::result_of<Fun(Args...)>::type> {
+	->Future<std::invoke_result_t<Fun, Args...>> {
 	return ThreadPool::Current()->AddWork(
-		std::bind(std::forward<Fun>(f), std::forward<Args>(args)...));
+		[f, args...]() mutable { return f(args...); });
 }
 
 }
@@ -12,7 +12,6 @@
 #include <memory>
 #include <string>
 #include <utility>
-#include <chrono>
 
 #include "base/base_export.h"
 #include "base/callback.h"
@@ -22,6 +21,7 @@
 #include "base/single_thread_task_runner.h"
 #include "base/post_task_and_reply_with_result_internal.h"
 #include "base/task_runner_util.h"
+#include "base/time/time.h"
 
 namespace sun {
 
@@ -47,14 +47,14 @@ class BASE_EXPORT BrowserThread {
 	 static bool PostDelayedTask(ID identifier,
 								 const base::Location& from_here,
 								 base::OnceClosure task,
-								 std::chrono::milliseconds delay);
+								 base::TimeDelta delay);
 	 static bool PostNonNestableTask(ID identifier,
 									 const base::Location& from_here,
 									 base::OnceClosure task);
 	 static bool PostNonNestableDelayedTask(ID identifier,
 											const base::Location& from_here,
 											base::OnceClosure task,
-											std::chrono::milliseconds delay);
+											base::TimeDelta delay);
 
 	 static bool PostTaskAndReply(ID identifier,
 								  const base::Location& from_here,
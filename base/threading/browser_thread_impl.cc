@@ -25,14 +25,14 @@ class BrowserThreadTaskRunner : public base::SingleThreadTaskRunner {
 
 	bool PostDelayedTask(const base::Location& from_here,
 						 base::OnceClosure task,
-						 std::chrono::milliseconds delay) OVERRIDE {
+						 base::TimeDelta delay) OVERRIDE {
 		return BrowserThread::PostDelayedTask(id_, from_here, std::move(task),
 											  delay);
 	}
 
 	bool PostNonNestableDelayedTask(const base::Location& from_here,
 								   base::OnceClosure task,
-								   std::chrono::milliseconds delay) OVERRIDE {
+								   base::TimeDelta delay) OVERRIDE {
 		return BrowserThread::PostNonNestableDelayedTask(id_, from_here,
 														 std::move(task),
 														 delay);
@@ -95,7 +95,7 @@ base::LazyInstance<BrowserThreadGlobals>::Leaky
 bool PostTaskHelper(BrowserThread::ID identifier,
 					const base::Location& from_here,
 					base::OnceClosure task,
-					std::chrono::milliseconds delay,
+					base::TimeDelta delay,
 					bool nestable) {
 	DCHECK_GE(identifier, 0);
 	DCHECK_LT(identifier, BrowserThread::ID_COUNT);
@@ -197,14 +197,14 @@ bool BrowserThread::PostTask(ID identifier,
 							 const base::Location& from_here,
 							 base::OnceClosure task) {
 	return PostTaskHelper(identifier, from_here, std::move(task),
-						  std::chrono::milliseconds(0), true);
+						  base::TimeDelta(), true);
 }
 
 // static method.
 bool BrowserThread::PostDelayedTask(ID identifier,
 									const base::Location & from_here,
 									base::OnceClosure task,
-									std::chrono::milliseconds delay) {
+									base::TimeDelta delay) {
 	return PostTaskHelper(identifier, from_here, std::move(task),
 						  delay, true);
 }
@@ -214,14 +214,14 @@ bool BrowserThread::PostNonNestableTask(ID identifier,
 										const base::Location & from_here,
 										base::OnceClosure task) {
 	return PostTaskHelper(identifier, from_here, std::move(task),
-						  std::chrono::milliseconds(0), false);
+						  base::TimeDelta(), false);
 }
 
 // static method.
 bool BrowserThread::PostNonNestableDelayedTask(ID identifier,
 											   const base::Location & from_here,
 											   base::OnceClosure task,
-											   std::chrono::milliseconds delay) {
+											   base::TimeDelta delay) {
 	return PostTaskHelper(identifier, from_here, std::move(task),
 						  delay, false);
 }
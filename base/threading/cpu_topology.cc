@@ -0,0 +1,152 @@
+﻿/**
+* @Author: YangGuang
+* @Date:   2026-10-17
+* @Email:  guang334419520@126.com
+* @Filename: cpu_topology.cc
+* @Last modified by:  YangGuang
+*/
+#include "base/threading/cpu_topology.h"
+
+#if defined(OS_LINUX)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#include <stdlib.h>
+
+#include <algorithm>
+#include <exception>
+#include <fstream>
+#include <map>
+#include <set>
+#include <sstream>
+#include <string>
+#include <thread>
+
+namespace base {
+
+namespace {
+
+#if defined(OS_LINUX)
+
+const char kSysCpuPath[] = "/sys/devices/system/cpu/";
+const char kSysNodePath[] = "/sys/devices/system/node/";
+
+bool ReadFirstLine(const std::string& path, std::string* line) {
+	std::ifstream file(path);
+	return file && std::getline(file, *line);
+}
+
+// 解析 "0-3,8,10-11" 这种格式的cpu list.
+std::vector<int> ParseCpuList(const std::string& list) {
+	std::vector<int> result;
+	std::stringstream stream(list);
+	std::string range;
+	while (std::getline(stream, range, ',')) {
+		if (range.empty())
+			continue;
+		const std::size_t dash = range.find('-');
+		try {
+			const int first = std::stoi(range.substr(0, dash));
+			const int last = dash == std::string::npos ?
+				first : std::stoi(range.substr(dash + 1));
+			for (int cpu = first; cpu <= last; ++cpu)
+				result.push_back(cpu);
+		}
+		catch (const std::exception&) {
+			return std::vector<int>();
+		}
+	}
+	return result;
+}
+
+std::vector<int> ReadCpuList(const std::string& path) {
+	std::string line;
+	if (!ReadFirstLine(path, &line))
+		return std::vector<int>();
+	return ParseCpuList(line);
+}
+
+// 用共享最后一级cache的CPU里面最小的id作为cache_id.
+int ReadCacheId(int cpu) {
+	int cache_id = cpu;
+	int best_level = 0;
+	for (int index = 0;; ++index) {
+		const std::string dir = std::string(kSysCpuPath) + "cpu" +
+			std::to_string(cpu) + "/cache/index" + std::to_string(index) + "/";
+		std::string level_line;
+		if (!ReadFirstLine(dir + "level", &level_line))
+			break;
+
+		const int level = std::atoi(level_line.c_str());
+		if (level <= best_level)
+			continue;
+		const std::vector<int> shared = ReadCpuList(dir + "shared_cpu_list");
+		if (shared.empty())
+			continue;
+		best_level = level;
+		cache_id = *std::min_element(shared.begin(), shared.end());
+	}
+	return cache_id;
+}
+
+#endif	// defined(OS_LINUX)
+
+}	// namespace.
+
+// static
+const CpuTopology& CpuTopology::Get() {
+	static const CpuTopology* topology = new CpuTopology;
+	return *topology;
+}
+
+CpuTopology::CpuTopology() : node_count_(1) {
+#if defined(OS_LINUX)
+	std::map<int, int> node_of_cpu;
+	const std::vector<int> nodes = ReadCpuList(std::string(kSysNodePath) + "online");
+	for (int node : nodes) {
+		const std::vector<int> node_cpus = ReadCpuList(
+			std::string(kSysNodePath) + "node" + std::to_string(node) + "/cpulist");
+		for (int cpu : node_cpus)
+			node_of_cpu[cpu] = node;
+	}
+
+	std::set<int> seen_nodes;
+	for (int cpu : ReadCpuList(std::string(kSysCpuPath) + "online")) {
+		auto it = node_of_cpu.find(cpu);
+		const int node = it == node_of_cpu.end() ? 0 : it->second;
+		seen_nodes.insert(node);
+		cpus_.push_back(Cpu{ cpu, ReadCacheId(cpu), node });
+	}
+	if (!seen_nodes.empty())
+		node_count_ = seen_nodes.size();
+#endif
+
+	if (cpus_.empty()) {
+		const int count = std::max(1u, std::thread::hardware_concurrency());
+		for (int cpu = 0; cpu < count; ++cpu)
+			cpus_.push_back(Cpu{ cpu, 0, 0 });
+	}
+
+	std::sort(cpus_.begin(), cpus_.end(), [](const Cpu& a, const Cpu& b) {
+		if (a.node_id != b.node_id)
+			return a.node_id < b.node_id;
+		if (a.cache_id != b.cache_id)
+			return a.cache_id < b.cache_id;
+		return a.id < b.id;
+	});
+}
+
+// static
+bool CpuTopology::PinCurrentThreadToCpu(int cpu_id) {
+#if defined(OS_LINUX)
+	cpu_set_t set;
+	CPU_ZERO(&set);
+	CPU_SET(cpu_id, &set);
+	return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#else
+	return false;
+#endif
+}
+
+}	// namespace base.
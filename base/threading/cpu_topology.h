@@ -0,0 +1,52 @@
+﻿/**
+* @Author: YangGuang
+* @Date:   2026-10-17
+* @Email:  guang334419520@126.com
+* @Filename: cpu_topology.h
+* @Last modified by:  YangGuang
+*/
+#ifndef BASE_THREADING_CPU_TOPOLOGY_H
+#define BASE_THREADING_CPU_TOPOLOGY_H
+
+#include <vector>
+
+#include "base/base_export.h"
+#include "base/macor.h"
+
+namespace base {
+
+// 机器的CPU拓扑: 每一个在线的逻辑CPU属于哪一个L3 cache(core complex)和哪一个
+// NUMA节点. Linux上从/sys/devices/system/cpu 和 /sys/devices/system/node 读取,
+// 读取失败或者其他平台上，认为所有的CPU共享同一个cache和节点.
+class BASE_EXPORT CpuTopology {
+ public:
+	 struct Cpu {
+		 int id;
+		 // 共享同一个最后一级cache的CPU有相同的cache_id.
+		 int cache_id;
+		 int node_id;
+	 };
+
+	 // 第一次调用的时候读取, 之后一直使用同一个结果.
+	 static const CpuTopology& Get();
+
+	 // 按照(node_id, cache_id, id)排序, 相邻的CPU尽量在同一个cache和节点上.
+	 const std::vector<Cpu>& cpus() const { return cpus_; }
+
+	 std::size_t node_count() const { return node_count_; }
+
+	 // 把调用线程绑定到|cpu_id|上, 不支持的平台返回false.
+	 static bool PinCurrentThreadToCpu(int cpu_id);
+
+ private:
+	 CpuTopology();
+
+	 std::vector<Cpu> cpus_;
+	 std::size_t node_count_;
+
+	 DISALLOW_COPY_AND_ASSIGN(CpuTopology);
+};
+
+}	// namespace base.
+
+#endif // !BASE_THREADING_CPU_TOPOLOGY_H
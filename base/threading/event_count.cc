@@ -0,0 +1,138 @@
+﻿/**
+* @Author: YangGuang
+* @Date:   2026-10-17
+* @Email:  guang334419520@126.com
+* @Filename: event_count.cc
+* @Last modified by:  YangGuang
+*/
+#include "base/threading/event_count.h"
+
+#include <limits.h>
+#include <time.h>
+
+#if defined(OS_LINUX)
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#endif
+
+#include "base/logging.h"
+
+namespace base {
+
+namespace {
+
+#if defined(OS_LINUX)
+
+void FutexWait(std::atomic<uint32_t>* address, uint32_t expected) {
+	syscall(SYS_futex, reinterpret_cast<uint32_t*>(address),
+			FUTEX_WAIT_PRIVATE, expected, nullptr, nullptr, 0);
+}
+
+void FutexWaitFor(std::atomic<uint32_t>* address,
+				  uint32_t expected,
+				  std::chrono::nanoseconds timeout) {
+	const auto seconds = std::chrono::duration_cast<std::chrono::seconds>(timeout);
+	struct timespec ts;
+	ts.tv_sec = static_cast<time_t>(seconds.count());
+	ts.tv_nsec = static_cast<long>((timeout - seconds).count());
+	syscall(SYS_futex, reinterpret_cast<uint32_t*>(address),
+			FUTEX_WAIT_PRIVATE, expected, &ts, nullptr, 0);
+}
+
+void FutexWake(std::atomic<uint32_t>* address, int count) {
+	syscall(SYS_futex, reinterpret_cast<uint32_t*>(address),
+			FUTEX_WAKE_PRIVATE, count, nullptr, nullptr, 0);
+}
+
+#endif	// defined(OS_LINUX)
+
+}	// namespace .
+
+EventCount::EventCount() : epoch_(0), waiters_(0) {}
+
+EventCount::~EventCount() {
+	DCHECK_EQ(waiters_.load(), 0);
+}
+
+EventCount::Key EventCount::PrepareWait() {
+	waiters_.fetch_add(1, std::memory_order_seq_cst);
+	return epoch_.load(std::memory_order_seq_cst);
+}
+
+void EventCount::CancelWait() {
+	waiters_.fetch_sub(1, std::memory_order_seq_cst);
+}
+
+void EventCount::Wait(Key key) {
+#if defined(OS_LINUX)
+	while (epoch_.load(std::memory_order_acquire) == key)
+		FutexWait(&epoch_, key);
+#else
+	{
+		std::unique_lock<std::mutex> lock(mutex_);
+		while (epoch_.load(std::memory_order_acquire) == key)
+			cond_var_.wait(lock);
+	}
+#endif
+	waiters_.fetch_sub(1, std::memory_order_seq_cst);
+}
+
+bool EventCount::WaitFor(Key key, std::chrono::nanoseconds timeout) {
+	const auto deadline = std::chrono::steady_clock::now() + timeout;
+	bool notified = true;
+#if defined(OS_LINUX)
+	while (epoch_.load(std::memory_order_acquire) == key) {
+		const auto now = std::chrono::steady_clock::now();
+		if (now >= deadline) {
+			notified = false;
+			break;
+		}
+		FutexWaitFor(&epoch_, key, deadline - now);
+	}
+#else
+	{
+		std::unique_lock<std::mutex> lock(mutex_);
+		notified = cond_var_.wait_until(lock, deadline, [this, key]() {
+			return epoch_.load(std::memory_order_acquire) != key;
+		});
+	}
+#endif
+	waiters_.fetch_sub(1, std::memory_order_seq_cst);
+	return notified;
+}
+
+void EventCount::NotifyOne() {
+	Notify(1);
+}
+
+void EventCount::NotifyAll() {
+	Notify(INT_MAX);
+}
+
+void EventCount::Notify(int count) {
+	DCHECK_GE(count, 1);
+	// 这个屏障和PrepareWait()里面的fetch_add配对, 保证调用者在Notify之前写入的条件，
+	// 要么被等待者在PrepareWait()之后的检查看到，要么我们在这里看到等待者.
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	if (waiters_.load(std::memory_order_relaxed) == 0)
+		return;
+
+#if defined(OS_LINUX)
+	epoch_.fetch_add(1, std::memory_order_release);
+	FutexWake(&epoch_, count);
+#else
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		epoch_.fetch_add(1, std::memory_order_release);
+	}
+	if (count >= waiters_.load(std::memory_order_relaxed)) {
+		cond_var_.notify_all();
+	}
+	else {
+		for (int i = 0; i < count; ++i)
+			cond_var_.notify_one();
+	}
+#endif
+}
+
+}	// namespace base.
@@ -0,0 +1,88 @@
+﻿/**
+* @Author: YangGuang
+* @Date:   2026-10-17
+* @Email:  guang334419520@126.com
+* @Filename: event_count.h
+* @Last modified by:  YangGuang
+*/
+#ifndef BASE_THREADING_EVENT_COUNT_H
+#define BASE_THREADING_EVENT_COUNT_H
+
+#include <stdint.h>
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <condition_variable>
+
+#include "base/base_export.h"
+#include "base/macor.h"
+
+namespace base {
+
+// EventCount 是一个用来让线程在"条件不满足"时睡眠的同步原语, 它不保存条件本身,
+// 条件由调用者自己检查. 使用方式如下:
+//
+//   // 等待者
+//   EventCount::Key key = ec.PrepareWait();
+//   if (condition()) {
+//       ec.CancelWait();
+//   } else {
+//       ec.Wait(key);
+//   }
+//
+//   // 通知者
+//   make_condition_true();
+//   ec.NotifyOne();
+//
+// 在没有等待者的时候，Notify*() 只需要一次内存屏障和一次load, 不会进入内核.
+// Linux上使用futex实现睡眠，其他平台退化为std::condition_variable.
+class BASE_EXPORT EventCount {
+ public:
+	 using Key = uint32_t;
+
+	 EventCount();
+	 ~EventCount();
+
+	 // 声明自己将要睡眠，返回一个key, 之后必须调用Wait() or CancelWait().
+	 Key PrepareWait();
+
+	 // 在PrepareWait()之后发现条件已经满足，放弃睡眠.
+	 void CancelWait();
+
+	 // 睡眠直到在PrepareWait()之后有Notify*()被调用.
+	 void Wait(Key key);
+
+	 // 和Wait()一样，但是最多睡眠|timeout|, 超时返回false.
+	 bool WaitFor(Key key, std::chrono::nanoseconds timeout);
+
+	 // 唤醒一个/所有的等待者，如果没有等待者，什么都不做.
+	 void NotifyOne();
+	 void NotifyAll();
+
+	 // 最多唤醒|count|个等待者.
+	 void Notify(int count);
+
+	 bool HasWaiters() const {
+		 return waiters_.load(std::memory_order_relaxed) > 0;
+	 }
+
+ private:
+
+	 // 每一次有效的Notify都会使epoch_加1, 等待者在epoch_改变之前一直睡眠.
+	 std::atomic<uint32_t> epoch_;
+
+	 // 已经调用PrepareWait()但是还没有离开Wait()/CancelWait()的线程数量.
+	 std::atomic<int32_t> waiters_;
+
+#if !defined(OS_LINUX)
+	 std::mutex mutex_;
+	 std::condition_variable cond_var_;
+#endif
+
+	 DISALLOW_COPY_AND_ASSIGN(EventCount);
+};
+
+}	// namespace base.
+
+#endif // !BASE_THREADING_EVENT_COUNT_H
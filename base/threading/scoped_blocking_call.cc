@@ -0,0 +1,38 @@
+﻿/**
+* @Author: YangGuang
+* @Date:   2026-10-17
+* @Email:  guang334419520@126.com
+* @Filename: scoped_blocking_call.cc
+* @Last modified by:  YangGuang
+*/
+#include "base/threading/scoped_blocking_call.h"
+
+#include "base/thread_pool.h"
+
+namespace base {
+
+namespace {
+
+thread_local bool g_in_blocking_call = false;
+
+}	// namespace.
+
+ScopedBlockingCall::ScopedBlockingCall() : pool_(nullptr) {
+	if (g_in_blocking_call)
+		return;
+
+	pool_ = ThreadPool::CurrentWorkerPool();
+	if (pool_) {
+		g_in_blocking_call = true;
+		pool_->BlockingStarted();
+	}
+}
+
+ScopedBlockingCall::~ScopedBlockingCall() {
+	if (pool_) {
+		pool_->BlockingEnded();
+		g_in_blocking_call = false;
+	}
+}
+
+}	// namespace base.
@@ -0,0 +1,48 @@
+﻿/**
+* @Author: YangGuang
+* @Date:   2026-10-17
+* @Email:  guang334419520@126.com
+* @Filename: scoped_blocking_call.h
+* @Last modified by:  YangGuang
+*/
+#ifndef BASE_THREADING_SCOPED_BLOCKING_CALL_H
+#define BASE_THREADING_SCOPED_BLOCKING_CALL_H
+
+#include "base/base_export.h"
+#include "base/macor.h"
+
+namespace base {
+
+class ThreadPool;
+
+// 标记当前线程在这个作用域里面会执行可能阻塞的操作(文件I/O, 等待外部进程等等).
+//
+// 在ThreadPool的工作线程上使用的时候，如果剩下的没有阻塞的工作线程不够
+// ThreadPool::thread_num(), 线程池会临时增加一个工作线程来顶替, 这样CPU任务不会
+// 因为阻塞的任务而饿死. 多出来的线程空闲一段时间以后会自动退出.
+// 在其他线程上使用的时候什么也不做. 嵌套使用的时候只有最外层的生效.
+//
+// Sample usage:
+//   void LoadFileTask(const std::string& path) {
+//     std::string content;
+//     {
+//       base::ScopedBlockingCall scoped_blocking_call;
+//       content = ReadFile(path);
+//     }
+//     Parse(content);
+//   }
+class BASE_EXPORT ScopedBlockingCall {
+ public:
+	 ScopedBlockingCall();
+	 ~ScopedBlockingCall();
+
+ private:
+	 // 如果是外层的ScopedBlockingCall, 或者不在工作线程上，为nullptr.
+	 ThreadPool* pool_;
+
+	 DISALLOW_COPY_AND_ASSIGN(ScopedBlockingCall);
+};
+
+}	// namespace base.
+
+#endif // !BASE_THREADING_SCOPED_BLOCKING_CALL_H
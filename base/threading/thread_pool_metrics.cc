@@ -0,0 +1,210 @@
+﻿/**
+* @Author: YangGuang
+* @Date:   2026-10-17
+* @Email:  guang334419520@126.com
+* @Filename: thread_pool_metrics.cc
+* @Last modified by:  YangGuang
+*/
+#include "base/threading/thread_pool_metrics.h"
+
+#include <chrono>
+#include <sstream>
+
+namespace base {
+
+namespace {
+
+std::size_t BucketForValue(uint64_t value) {
+	std::size_t bucket = 0;
+	while (value != 0 && bucket + 1 < ThreadPoolMetrics::Histogram::kBucketCount) {
+		value >>= 1;
+		++bucket;
+	}
+	return bucket;
+}
+
+uint64_t BucketUpperBound(std::size_t bucket) {
+	return bucket == 0 ? 0 : (uint64_t(1) << bucket) - 1;
+}
+
+void AppendHistogramText(std::ostringstream& out,
+						 const char* name,
+						 const ThreadPoolMetrics::Histogram& histogram) {
+	out << " " << name << "{count=" << histogram.count
+		<< " mean=" << histogram.Mean()
+		<< " p50=" << histogram.Percentile(0.5)
+		<< " p99=" << histogram.Percentile(0.99) << "}";
+}
+
+void AppendHistogramJson(std::ostringstream& out,
+						 const char* name,
+						 const ThreadPoolMetrics::Histogram& histogram) {
+	out << "\"" << name << "\":{\"count\":" << histogram.count
+		<< ",\"sum_ns\":" << histogram.sum
+		<< ",\"p50_ns\":" << histogram.Percentile(0.5)
+		<< ",\"p99_ns\":" << histogram.Percentile(0.99)
+		<< ",\"buckets\":[";
+	for (std::size_t i = 0; i < ThreadPoolMetrics::Histogram::kBucketCount; ++i) {
+		if (i)
+			out << ",";
+		out << histogram.buckets[i];
+	}
+	out << "]}";
+}
+
+void AppendWorkerText(std::ostringstream& out,
+					  const char* label,
+					  const ThreadPoolMetrics::Worker& worker) {
+	out << label;
+	if (worker.index >= 0)
+		out << " " << worker.index;
+	out << ": run=" << worker.tasks_run
+		<< " local=" << worker.local_tasks
+		<< " pool=" << worker.pool_tasks
+		<< " stolen=" << worker.stolen_tasks
+		<< " failed_steals=" << worker.failed_steals
+		<< " depth=" << worker.queue_depth;
+	AppendHistogramText(out, "queue_wait_ns", worker.queue_wait);
+	AppendHistogramText(out, "run_ns", worker.run_time);
+	out << "\n";
+}
+
+void AppendWorkerJson(std::ostringstream& out,
+					  const ThreadPoolMetrics::Worker& worker) {
+	out << "{\"index\":" << worker.index
+		<< ",\"tasks_run\":" << worker.tasks_run
+		<< ",\"local_tasks\":" << worker.local_tasks
+		<< ",\"pool_tasks\":" << worker.pool_tasks
+		<< ",\"stolen_tasks\":" << worker.stolen_tasks
+		<< ",\"failed_steals\":" << worker.failed_steals
+		<< ",\"queue_depth\":" << worker.queue_depth << ",";
+	AppendHistogramJson(out, "queue_wait", worker.queue_wait);
+	out << ",";
+	AppendHistogramJson(out, "run_time", worker.run_time);
+	out << "}";
+}
+
+}	// namespace.
+
+ThreadPoolMetrics::Histogram::Histogram() : count(0), sum(0) {
+	for (uint64_t& bucket : buckets)
+		bucket = 0;
+}
+
+void ThreadPoolMetrics::Histogram::Merge(const Histogram& other) {
+	for (std::size_t i = 0; i < kBucketCount; ++i)
+		buckets[i] += other.buckets[i];
+	count += other.count;
+	sum += other.sum;
+}
+
+uint64_t ThreadPoolMetrics::Histogram::Percentile(double fraction) const {
+	if (count == 0)
+		return 0;
+	const uint64_t rank = static_cast<uint64_t>(fraction * (count - 1)) + 1;
+	uint64_t seen = 0;
+	for (std::size_t i = 0; i < kBucketCount; ++i) {
+		seen += buckets[i];
+		if (seen >= rank)
+			return BucketUpperBound(i);
+	}
+	return BucketUpperBound(kBucketCount - 1);
+}
+
+ThreadPoolMetrics::Worker::Worker()
+	: index(-1),
+	  tasks_run(0),
+	  local_tasks(0),
+	  pool_tasks(0),
+	  stolen_tasks(0),
+	  failed_steals(0),
+	  queue_depth(0) {}
+
+ThreadPoolMetrics::ThreadPoolMetrics() : pool_queue_depth(0) {}
+
+ThreadPoolMetrics::~ThreadPoolMetrics() = default;
+
+ThreadPoolMetrics::Worker ThreadPoolMetrics::Total() const {
+	Worker total;
+	for (const Worker& worker : workers) {
+		total.tasks_run += worker.tasks_run;
+		total.local_tasks += worker.local_tasks;
+		total.pool_tasks += worker.pool_tasks;
+		total.stolen_tasks += worker.stolen_tasks;
+		total.failed_steals += worker.failed_steals;
+		total.queue_depth += worker.queue_depth;
+		total.queue_wait.Merge(worker.queue_wait);
+		total.run_time.Merge(worker.run_time);
+	}
+	return total;
+}
+
+std::string ThreadPoolMetrics::ToText() const {
+	std::ostringstream out;
+	out << "pool_queue_depth=" << pool_queue_depth << "\n";
+	for (const Worker& worker : workers)
+		AppendWorkerText(out, worker.index >= 0 ? "worker" : "helpers", worker);
+	AppendWorkerText(out, "total", Total());
+	return out.str();
+}
+
+std::string ThreadPoolMetrics::ToJson() const {
+	std::ostringstream out;
+	out << "{\"pool_queue_depth\":" << pool_queue_depth << ",\"workers\":[";
+	for (std::size_t i = 0; i < workers.size(); ++i) {
+		if (i)
+			out << ",";
+		AppendWorkerJson(out, workers[i]);
+	}
+	out << "],\"total\":";
+	AppendWorkerJson(out, Total());
+	out << "}";
+	return out.str();
+}
+
+namespace internal {
+
+AtomicHistogram::AtomicHistogram() : sum_(0) {
+	for (std::atomic<uint64_t>& bucket : buckets_)
+		bucket.store(0, std::memory_order_relaxed);
+}
+
+void AtomicHistogram::Record(uint64_t value) {
+	buckets_[BucketForValue(value)].fetch_add(1, std::memory_order_relaxed);
+	sum_.fetch_add(value, std::memory_order_relaxed);
+}
+
+void AtomicHistogram::Snapshot(ThreadPoolMetrics::Histogram* histogram) const {
+	histogram->count = 0;
+	for (std::size_t i = 0; i < ThreadPoolMetrics::Histogram::kBucketCount; ++i) {
+		histogram->buckets[i] = buckets_[i].load(std::memory_order_relaxed);
+		histogram->count += histogram->buckets[i];
+	}
+	histogram->sum = sum_.load(std::memory_order_relaxed);
+}
+
+WorkerMetricsRecorder::WorkerMetricsRecorder()
+	: tasks_run(0),
+	  local_tasks(0),
+	  pool_tasks(0),
+	  stolen_tasks(0),
+	  failed_steals(0) {}
+
+void WorkerMetricsRecorder::Snapshot(ThreadPoolMetrics::Worker* worker) const {
+	worker->tasks_run = tasks_run.load(std::memory_order_relaxed);
+	worker->local_tasks = local_tasks.load(std::memory_order_relaxed);
+	worker->pool_tasks = pool_tasks.load(std::memory_order_relaxed);
+	worker->stolen_tasks = stolen_tasks.load(std::memory_order_relaxed);
+	worker->failed_steals = failed_steals.load(std::memory_order_relaxed);
+	queue_wait.Snapshot(&worker->queue_wait);
+	run_time.Snapshot(&worker->run_time);
+}
+
+int64_t MetricsNowNanoseconds() {
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(
+		std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+}	// namespace internal.
+
+}	// namespace base.
@@ -0,0 +1,118 @@
+﻿/**
+* @Author: YangGuang
+* @Date:   2026-10-17
+* @Email:  guang334419520@126.com
+* @Filename: thread_pool_metrics.h
+* @Last modified by:  YangGuang
+*/
+#ifndef BASE_THREADING_THREAD_POOL_METRICS_H
+#define BASE_THREADING_THREAD_POOL_METRICS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+#include <string>
+#include <vector>
+
+#include "base/base_export.h"
+#include "base/macor.h"
+
+namespace base {
+
+// ThreadPool::GetMetrics()返回的快照. 所有的时间都是纳秒.
+struct BASE_EXPORT ThreadPoolMetrics {
+	// 以2为底的对数直方图, 第0个桶是0, 第i个桶是[2^(i-1), 2^i).
+	struct BASE_EXPORT Histogram {
+		static constexpr std::size_t kBucketCount = 40;
+
+		Histogram();
+
+		void Merge(const Histogram& other);
+
+		uint64_t Mean() const { return count ? sum / count : 0; }
+
+		// 近似的分位数(|fraction|在[0, 1]之间), 返回所在的桶的上界.
+		uint64_t Percentile(double fraction) const;
+
+		uint64_t buckets[kBucketCount];
+		uint64_t count;
+		uint64_t sum;
+	};
+
+	struct BASE_EXPORT Worker {
+		Worker();
+
+		// 工作线程的index, 非工作线程(在RunPendingTask()里面帮忙的线程)合在
+		// 一起，index是-1.
+		int index;
+		uint64_t tasks_run;
+		// 分别从自己的队列、|pool_work_queue_|和其他线程的队列里面取到的任务数.
+		uint64_t local_tasks;
+		uint64_t pool_tasks;
+		uint64_t stolen_tasks;
+		// 所有的地方都没有找到任务的次数.
+		uint64_t failed_steals;
+		// 快照时自己的队列里面大约还有多少个任务.
+		std::size_t queue_depth;
+		// 任务在|pool_work_queue_|里面等待的时间.
+		Histogram queue_wait;
+		Histogram run_time;
+	};
+
+	ThreadPoolMetrics();
+	~ThreadPoolMetrics();
+
+	// 所有线程加在一起.
+	Worker Total() const;
+
+	std::string ToText() const;
+	std::string ToJson() const;
+
+	std::vector<Worker> workers;
+	// 快照时|pool_work_queue_|里面大约还有多少个任务.
+	std::size_t pool_queue_depth;
+};
+
+namespace internal {
+
+// 可以并发记录的直方图, 所有的操作都是relaxed原子操作, 没有锁.
+class BASE_EXPORT AtomicHistogram {
+ public:
+	 AtomicHistogram();
+
+	 void Record(uint64_t value);
+
+	 void Snapshot(ThreadPoolMetrics::Histogram* histogram) const;
+
+ private:
+	 std::atomic<uint64_t> buckets_[ThreadPoolMetrics::Histogram::kBucketCount];
+	 std::atomic<uint64_t> sum_;
+
+	 DISALLOW_COPY_AND_ASSIGN(AtomicHistogram);
+};
+
+// 一个工作线程的计数器. 基本上只有它自己的线程会写, 单独占用cache line避免
+// 和其他线程false sharing.
+struct alignas(64) WorkerMetricsRecorder {
+	WorkerMetricsRecorder();
+
+	void Snapshot(ThreadPoolMetrics::Worker* worker) const;
+
+	std::atomic<uint64_t> tasks_run;
+	std::atomic<uint64_t> local_tasks;
+	std::atomic<uint64_t> pool_tasks;
+	std::atomic<uint64_t> stolen_tasks;
+	std::atomic<uint64_t> failed_steals;
+	AtomicHistogram queue_wait;
+	AtomicHistogram run_time;
+};
+
+// 单调时钟, 纳秒.
+BASE_EXPORT int64_t MetricsNowNanoseconds();
+
+}	// namespace internal.
+
+}	// namespace base.
+
+#endif // !BASE_THREADING_THREAD_POOL_METRICS_H
@@ -0,0 +1,27 @@
+﻿/**
+* @Author: YangGuang
+* @Date:   2026-10-17
+* @Email:  guang334419520@126.com
+* @Filename: tick_clock.h
+* @Last modified by:  YangGuang
+*/
+#ifndef BASE_TIME_TICK_CLOCK_H
+#define BASE_TIME_TICK_CLOCK_H
+
+#include "base/base_export.h"
+#include "base/time/time.h"
+
+namespace base {
+
+// 一个可以替换的单调时钟, 主要给测试用来控制timer看到的当前时间.
+class BASE_EXPORT TickClock {
+ public:
+	 virtual ~TickClock() = default;
+
+	 // 返回当前的时间点, 必须是单调递增的.
+	 virtual TimeTicks NowTicks() const = 0;
+};
+
+}	// namespace base.
+
+#endif // !BASE_TIME_TICK_CLOCK_H
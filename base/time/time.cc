@@ -0,0 +1,41 @@
+﻿/**
+* @Author: YangGuang
+* @Date:   2026-10-17
+* @Email:  guang334419520@126.com
+* @Filename: time.cc
+* @Last modified by:  YangGuang
+*/
+#include "base/time/time.h"
+
+#if defined(OS_POSIX)
+#include <time.h>
+#endif
+
+#include "base/logging.h"
+
+namespace base {
+
+int64_t TimeDelta::InMillisecondsRoundedUp() const {
+	if (is_max())
+		return std::numeric_limits<int64_t>::max();
+
+	int64_t result = delta_ / 1000;
+	if (result * 1000 < delta_)
+		++result;
+	return result;
+}
+
+// static.
+TimeTicks TimeTicks::Now() {
+#if defined(OS_POSIX)
+	struct timespec ts;
+	CHECK_EQ(clock_gettime(CLOCK_MONOTONIC, &ts), 0);
+	return TimeTicks(static_cast<int64_t>(ts.tv_sec) * 1000 * 1000 +
+					 ts.tv_nsec / 1000);
+#else
+	return TimeTicks(std::chrono::duration_cast<std::chrono::microseconds>(
+		std::chrono::steady_clock::now().time_since_epoch()).count());
+#endif
+}
+
+}	// namespace base.
@@ -0,0 +1,162 @@
+﻿/**
+* @Author: YangGuang
+* @Date:   2026-10-17
+* @Email:  guang334419520@126.com
+* @Filename: time.h
+* @Last modified by:  YangGuang
+*/
+
+// TimeDelta 表示一段时间, TimeTicks 表示单调时钟上的一个时间点, 两个都精确到
+// 微秒. TimeTicks 在Linux上来自CLOCK_MONOTONIC, 不会因为调整系统时间而跳变,
+// 所以延迟任务和timer都应该使用它, 而不是std::chrono::system_clock.
+//
+// TimeDelta 可以从任意的std::chrono::duration隐式的构造, 所以
+//   task_runner->PostDelayedTask(FROM_HERE, task, std::chrono::milliseconds(10));
+// 和
+//   task_runner->PostDelayedTask(FROM_HERE, task, TimeDelta::FromMilliseconds(10));
+// 是一样的.
+
+#ifndef BASE_TIME_TIME_H
+#define BASE_TIME_TIME_H
+
+#include <stdint.h>
+
+#include <chrono>
+#include <limits>
+
+#include "base/base_export.h"
+#include "base/macor.h"
+
+namespace base {
+
+class BASE_EXPORT TimeDelta {
+ public:
+	 constexpr TimeDelta() : delta_(0) {}
+
+	 // 比微秒更小的部分会被舍去.
+	 template <typename Rep, typename Period>
+	 constexpr TimeDelta(const std::chrono::duration<Rep, Period>& duration)
+		 : delta_(static_cast<int64_t>(std::chrono::duration_cast<
+				  std::chrono::microseconds>(duration).count())) {}
+
+	 static constexpr TimeDelta FromMicroseconds(int64_t us) {
+		 return TimeDelta(us);
+	 }
+	 static constexpr TimeDelta FromMilliseconds(int64_t ms) {
+		 return TimeDelta(ms * 1000);
+	 }
+	 static constexpr TimeDelta FromSeconds(int64_t secs) {
+		 return TimeDelta(secs * 1000 * 1000);
+	 }
+
+	 // 比任何其他的TimeDelta都大.
+	 static constexpr TimeDelta Max() {
+		 return TimeDelta(std::numeric_limits<int64_t>::max());
+	 }
+
+	 constexpr bool is_zero() const { return delta_ == 0; }
+	 constexpr bool is_max() const {
+		 return delta_ == std::numeric_limits<int64_t>::max();
+	 }
+
+	 constexpr int64_t InMicroseconds() const { return delta_; }
+	 constexpr int64_t InMilliseconds() const { return delta_ / 1000; }
+	 // 不足一毫秒的部分向上取整, 用在只支持毫秒的等待上, 这样不会提前醒来.
+	 int64_t InMillisecondsRoundedUp() const;
+	 constexpr double InSecondsF() const {
+		 return static_cast<double>(delta_) / (1000 * 1000);
+	 }
+
+	 constexpr std::chrono::microseconds ToChrono() const {
+		 return std::chrono::microseconds(delta_);
+	 }
+
+	 constexpr TimeDelta operator+(TimeDelta other) const {
+		 return TimeDelta(delta_ + other.delta_);
+	 }
+	 constexpr TimeDelta operator-(TimeDelta other) const {
+		 return TimeDelta(delta_ - other.delta_);
+	 }
+	 constexpr TimeDelta operator-() const { return TimeDelta(-delta_); }
+	 constexpr TimeDelta operator*(int64_t a) const { return TimeDelta(delta_ * a); }
+	 constexpr TimeDelta operator/(int64_t a) const { return TimeDelta(delta_ / a); }
+	 TimeDelta& operator+=(TimeDelta other) {
+		 delta_ += other.delta_;
+		 return *this;
+	 }
+	 TimeDelta& operator-=(TimeDelta other) {
+		 delta_ -= other.delta_;
+		 return *this;
+	 }
+
+	 constexpr bool operator==(TimeDelta other) const { return delta_ == other.delta_; }
+	 constexpr bool operator!=(TimeDelta other) const { return delta_ != other.delta_; }
+	 constexpr bool operator<(TimeDelta other) const { return delta_ < other.delta_; }
+	 constexpr bool operator<=(TimeDelta other) const { return delta_ <= other.delta_; }
+	 constexpr bool operator>(TimeDelta other) const { return delta_ > other.delta_; }
+	 constexpr bool operator>=(TimeDelta other) const { return delta_ >= other.delta_; }
+
+ private:
+	 friend class TimeTicks;
+
+	 explicit constexpr TimeDelta(int64_t delta_us) : delta_(delta_us) {}
+
+	 // 微秒.
+	 int64_t delta_;
+};
+
+// 单调时钟上的时间点. 默认构造的是一个null的时间点, 一般用来表示"没有".
+class BASE_EXPORT TimeTicks {
+ public:
+	 constexpr TimeTicks() : ticks_(0) {}
+
+	 // 读取单调时钟, Linux上是clock_gettime(CLOCK_MONOTONIC), 不是系统调用(vDSO).
+	 static TimeTicks Now();
+
+	 // 比任何其他的时间点都晚, 加减任何TimeDelta以后还是Max().
+	 static constexpr TimeTicks Max() {
+		 return TimeTicks(std::numeric_limits<int64_t>::max());
+	 }
+
+	 constexpr bool is_null() const { return ticks_ == 0; }
+	 constexpr bool is_max() const {
+		 return ticks_ == std::numeric_limits<int64_t>::max();
+	 }
+
+	 // 从单调时钟的起点开始经过的时间, 用来和CLOCK_MONOTONIC上的其他接口交互
+	 // (例如timerfd).
+	 constexpr TimeDelta since_origin() const { return TimeDelta(ticks_); }
+
+	 TimeTicks operator+(TimeDelta delta) const {
+		 if (is_max() || delta.is_max())
+			 return Max();
+		 return TimeTicks(ticks_ + delta.delta_);
+	 }
+	 TimeTicks operator-(TimeDelta delta) const {
+		 if (is_max())
+			 return Max();
+		 return TimeTicks(ticks_ - delta.delta_);
+	 }
+	 TimeDelta operator-(TimeTicks other) const {
+		 return TimeDelta(ticks_ - other.ticks_);
+	 }
+	 TimeTicks& operator+=(TimeDelta delta) { return *this = *this + delta; }
+	 TimeTicks& operator-=(TimeDelta delta) { return *this = *this - delta; }
+
+	 constexpr bool operator==(TimeTicks other) const { return ticks_ == other.ticks_; }
+	 constexpr bool operator!=(TimeTicks other) const { return ticks_ != other.ticks_; }
+	 constexpr bool operator<(TimeTicks other) const { return ticks_ < other.ticks_; }
+	 constexpr bool operator<=(TimeTicks other) const { return ticks_ <= other.ticks_; }
+	 constexpr bool operator>(TimeTicks other) const { return ticks_ > other.ticks_; }
+	 constexpr bool operator>=(TimeTicks other) const { return ticks_ >= other.ticks_; }
+
+ private:
+	 explicit constexpr TimeTicks(int64_t ticks_us) : ticks_(ticks_us) {}
+
+	 // 单调时钟上的微秒数.
+	 int64_t ticks_;
+};
+
+}	// namespace base.
+
+#endif // !BASE_TIME_TIME_H
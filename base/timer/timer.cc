@@ -14,47 +14,18 @@
 #include "base/threading/platform_thread.h"
 #include "base/sequenced_task_runner_handle.h"
 #include "base/bind_util.h"
+#include "base/time/tick_clock.h"
 
 namespace base {
 namespace internal {
 
-class BaseTimerTaskInternal {
- public:
-	 explicit BaseTimerTaskInternal(TimerBase* timer) : timer_(timer) {}
-
-	 ~BaseTimerTaskInternal() {
-		 if (timer_)
-			 timer_->AdandonAndStop();
-	 }
-
-	 void Run() {
-		 if (!timer_)
-			 return;
-		 timer_->scheduled_task_ = nullptr;
-
-		 TimerBase* timer = timer_;
-		 timer_ = nullptr;
-		 timer->RunScheduledTask();
-	 }
-
-	 void Abandon() { timer_ = nullptr; }
-
- private:
-	 TimerBase* timer_;
-
-	 DISALLOW_COPY_AND_ASSIGN(BaseTimerTaskInternal);
-};
-
-
-
 TimerBase::TimerBase(bool retain_user_task, bool is_repeating)
 	: TimerBase(retain_user_task, is_repeating, nullptr) {}
 
 TimerBase::TimerBase(bool retain_user_task, 
 					 bool is_repeating,
 					 const TickClock* tick_clock)
-	: scheduled_task_(nullptr),
-	  is_repeating_(is_repeating),
+	: is_repeating_(is_repeating),
 	  retain_user_task_(retain_user_task),
 	  tick_clock_(tick_clock),
 	  is_running_(false) {}
@@ -70,8 +41,7 @@ TimerBase::TimerBase(const Location& posted_from,
 					 const base::Closure& user_task,
 					 bool is_repeating,
 					 const TickClock* tick_clock)
-	: scheduled_task_(nullptr),
-	  posted_from_(posted_from),
+	: posted_from_(posted_from),
 	  delay_(delay),
 	  user_task_(user_task),
 	  is_repeating_(is_repeating),
@@ -89,7 +59,7 @@ bool TimerBase::IsRunning() const {
 	return is_running_;
 }
 
-TimerBase::TimeDelta TimerBase::GetCurrentDelay() const {
+TimeDelta TimerBase::GetCurrentDelay() const {
 	return delay_;
 }
 
@@ -120,15 +90,15 @@ void TimerBase::Reset() {
 	DCHECK(!user_task_.is_null());
 
 	// 如果没有pending task，那么启动一个就返回.
-	if (!scheduled_task_) {
+	if (!delayed_task_handle_.IsValid()) {
 		PostNewScheduledTask(delay_);
 		return;
 	}
 
-	if (delay_ > std::chrono::milliseconds(0))
+	if (delay_ > TimeDelta())
 		desired_run_time_ = Now() + delay_;
 	else
-		desired_run_time_ = std::chrono::milliseconds(0);
+		desired_run_time_ = TimeTicks();
 
 	// We can use the existing scheduled task if it arrives before the new
 	// |desired_run_time_|.
@@ -137,31 +107,32 @@ void TimerBase::Reset() {
 		return;
 	}
 
-	// We can't reuse the |scheduled_task_|, so abandon it and post a new one.
+	// We can't reuse the scheduled task, so cancel it and post a new one.
 	AdandonScheduledTask();
 	PostNewScheduledTask(delay_);
 
 }
 
-std::chrono::milliseconds TimerBase::Now() const {
-	return std::chrono::duration_cast<std::chrono::milliseconds>(
-				std::chrono::system_clock::now().time_since_epoch());
+TimeTicks TimerBase::Now() const {
+	return tick_clock_ ? tick_clock_->NowTicks() : TimeTicks::Now();
 }
 
 void TimerBase::PostNewScheduledTask(TimeDelta delay) {
-	DCHECK(!scheduled_task_);
+	DCHECK(!delayed_task_handle_.IsValid());
 	is_running_ = true;
-	scheduled_task_ = new BaseTimerTaskInternal(this);
-	if (delay > TimeDelta(0)) {
-		GetTaskRunner()->PostDelayedTask(posted_from_,
-			base::BindOnceClosure(&BaseTimerTaskInternal::Run, scheduled_task_),
-		 delay);
+	// 任务只会在这个序列上运行或者取消, 而析构的时候会取消它, 所以可以直接
+	// 绑定|this|.
+	if (delay > TimeDelta()) {
+		delayed_task_handle_ = GetTaskRunner()->PostCancelableDelayedTask(
+			posted_from_, base::BindOnceClosure(&TimerBase::RunScheduledTask, this),
+			delay);
 		scheduled_run_time_ = desired_run_time_ = Now() + delay;
 	}
 	else {
-		GetTaskRunner()->PostTask(posted_from_,
-								  base::BindOnceClosure(&BaseTimerTaskInternal::Run,
-								  scheduled_task_));
+		delayed_task_handle_ = GetTaskRunner()->PostCancelableDelayedTask(
+			posted_from_, base::BindOnceClosure(&TimerBase::RunScheduledTask, this),
+			TimeDelta());
+		scheduled_run_time_ = desired_run_time_ = TimeTicks();
 	}
 }
 
@@ -170,10 +141,7 @@ std::shared_ptr<SequencedTaskRunner> TimerBase::GetTaskRunner() {
 }
 
 void TimerBase::AdandonScheduledTask() {
-	if (scheduled_task_) {
-		scheduled_task_->Abandon();
-		scheduled_task_ = nullptr;
-	}
+	delayed_task_handle_.CancelTask();
 }
 
 void TimerBase::RunScheduledTask() {
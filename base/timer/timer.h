@@ -21,7 +21,7 @@
 //      class MyClass {
 //       public:
 //          void StartDoingStuff() {
-//              timer.Start(FROM_HERE, TimerDelta::FromSeconds(1),
+//              timer.Start(FROM_HERE, TimeDelta::FromSeconds(1),
 //                          this, &MyClass::DoStuff);
 //          }
 //          void StopDoingStuff() {
@@ -54,13 +54,14 @@
 #define BASE_TIMER_TIMER_H
 
 #include <memory>
-#include <chrono>
 
 #include "base/base_export.h"
 #include "base/callback.h"
 #include "base/macor.h"
 #include "base/location.h"
 #include "base/sequenced_task_runner.h"
+#include "base/task/delayed_task_handle.h"
+#include "base/time/time.h"
 
 namespace base {
 
@@ -68,26 +69,21 @@ class TickClock;
 
 namespace internal {
 
-class BaseTimerTaskInternal;
-
-
 // 这个类包装了TaskRunner::PostDelayedTask来管理延迟和重复任务. 不要直接
 // 使用这个类， 而是使用OneShotTimer, RepeatingTimer, RetainingOneShotTimer.
 class BASE_EXPORT TimerBase {
  public:
-	using TimeDelta = std::chrono::milliseconds;
 	// 这两个构造函数代表是一个 one-shot或者repeating, 在开始之前必须要设置
 	// task， |retain_user_task|在这个user_task运行完成还保留就为true,
 	// 如果这个|tick_clock|是提供了，那么在调度任务的时候使用的就是它，而不是
-	// std::chrono::system_clock()::now().
-    // std::chrono::system_clock()::now().
+	// TimeTicks::Now().
     TimerBase(bool retain_user_task, bool is_repeating);
     TimerBase(bool retain_user_task,
               bool is_repeating,
               const TickClock* tick_clock);
 
 	// 构造一个retained task timer信息, 如果|tick_clock|是又提供了，那么就
-	// 使用它而不是使用std::chrono::system_clock()::now().
+	// 使用它而不是使用TimeTicks::Now().
 	TimerBase(const Location& posted_from,
 			  TimeDelta delay,
 			  const base::Closure& user_task,
@@ -146,15 +142,15 @@ class BASE_EXPORT TimerBase {
 	virtual void Reset();
 
 	const base::Closure& user_task() const { return user_task_; }
-	const std::chrono::milliseconds desired_run_time() const {
+	TimeTicks desired_run_time() const {
 		return desired_run_time_;
 	}
 
  protected:
-	 std::chrono::milliseconds Now() const;
+	 TimeTicks Now() const;
 
 	 void set_user_task(const Closure& task) { user_task_ = task; }
-	 void set_desired_run_time(std::chrono::milliseconds desired) {
+	 void set_desired_run_time(TimeTicks desired) {
 		 desired_run_time_ = desired;
 	 }
 	 void set_is_running(bool running) { is_running_ = running; }
@@ -164,24 +160,22 @@ class BASE_EXPORT TimerBase {
 	 std::shared_ptr<SequencedTaskRunner> task_runner_;
 
  private:
-	 friend class BaseTimerTaskInternal;
-
-	 // 分配一个新的|scheduled_task_|，并以给定的|延迟|将其发布到当前序列上。
-	 // |scheduled_task_|必须是null. |scheduled_run_time_| and 
-	 // |desired_run_time_| 都会被刷新用now() +  delay.
+	 // 以给定的|延迟|提交一个新的可以取消的任务到当前序列上，之前提交的任务必须
+	 // 已经运行或者被取消了. |scheduled_run_time_| and |desired_run_time_| 都会
+	 // 被刷新用now() +  delay.
 	 void PostNewScheduledTask(TimeDelta delay);
 
 	 // 返回应该调度任务的任务运行器。如果相应的|task_runner_|字段为null，则返回
 	 // 当前序列的task runner。
 	 std::shared_ptr<SequencedTaskRunner> GetTaskRunner();
 	 
-	 //禁用|scheduled_task_|，并放弃它，这样它就不再引用这个对象。
+	 // 取消已经提交的任务(如果有), 它会马上从延迟队列里面删除, 不会再引用这个对象.
 	 void AdandonScheduledTask();
 
 	 void RunScheduledTask();
 
-	 // 在这个不为null的时候, |scheduled_task_|会调用RunscheduledTask().
-	 BaseTimerTaskInternal* scheduled_task_;
+	 // 已经提交还没有运行的任务, 它运行的时候会调用RunScheduledTask().
+	 DelayedTaskHandle delayed_task_handle_;
 
 	 // Location in user code.
 	 Location posted_from_;
@@ -190,15 +184,15 @@ class BASE_EXPORT TimerBase {
 	 // |user_task| is what the user wants to be run at |desired_run_time|.
 	 base::Closure user_task_;
 
-	 // |scheduled_task|的预计发射时间, 如果这个必须立即执行，那么这个时间可能是0.
-	 std::chrono::milliseconds scheduled_run_time_;
+	 // |scheduled_task|的预计发射时间, 如果这个必须立即执行，那么这个时间可能是null.
+	 TimeTicks scheduled_run_time_;
 
 	 // 这个是|user_task_|想要运行的时间, 用户可以在随时更新这个时间, 即使它们之前
 	 // 请求的还没有执行. 如果|desired_run_time_|大于|scheduled_run_time_|,将发
 	 // 布一个延续任务，等待剩余的时间.这允许我们重用挂起的任务，这样当用户代码过度
 	 // 停止并启动计时器时，就不会用孤立的任务淹没延迟的队列。如果任务必须立即运行，
 	 // 那么这个时间可能是“零”时间刻度。
-	 std::chrono::milliseconds desired_run_time_;
+	 TimeTicks desired_run_time_;
 
 	 // 如果这个timer是一个重复执行任务就为true.并且retain_user_task_一样要是true.
 	 const bool is_repeating_;
@@ -9,52 +9,303 @@
 #ifndef BASE_WORK_STEALING_QUEUE_H
 #define BASE_WORK_STEALING_QUEUE_H
 
-#include <deque>
-#include <mutex>
+#include <stdint.h>
 
+#include <atomic>
+#include <memory>
+#include <vector>
+#include <type_traits>
+
+#include "base/macor.h"
 #include "base/task/function_wrapper.h"
 
 namespace base {
 
 namespace internal {
 
+// Chase-Lev work-stealing deque (参考 "Dynamic Circular Work-Stealing Deque"
+// 以及 Lê 等人给出的 C11 内存序版本).
+//
+// 只有拥有者线程可以调用Push() and TryPop(), 它们都在bottom端操作, 快速路径上
+// 没有任何原子RMW操作, 只有在队列里只剩最后一个元素时TryPop()才需要和偷取者竞争
+// 一次CAS. 其他线程只能调用TrySteal(), 从top端偷取，并且通过CAS top来竞争.
+//
+// 由于偷取者会投机的读取槽位(CAS失败的时候读到的值会被丢弃), 所以|T|必须是
+// trivially copyable的, 一般来说就是一个指针.
+// 环形数组满了之后拥有者会把它扩大一倍, 旧的数组可能还有偷取者在读，所以会一直保留
+// 到deque析构.
+template <typename T>
+class ChaseLevDeque {
+	 static_assert(std::is_trivially_copyable<T>::value,
+				   "ChaseLevDeque requires a trivially copyable element type");
+ public:
+	 explicit ChaseLevDeque(std::size_t initial_capacity = 256)
+		 : top_(0), bottom_(0) {
+		 std::size_t capacity = 1;
+		 while (capacity < initial_capacity)
+			 capacity <<= 1;
+		 arrays_.push_back(std::unique_ptr<Array>(new Array(capacity)));
+		 array_.store(arrays_.back().get(), std::memory_order_relaxed);
+	 }
+
+	 // 只能在拥有者线程调用.
+	 void Push(T value) {
+		 const int64_t b = bottom_.load(std::memory_order_relaxed);
+		 const int64_t t = top_.load(std::memory_order_acquire);
+		 Array* array = array_.load(std::memory_order_relaxed);
+		 if (b - t > static_cast<int64_t>(array->capacity()) - 1)
+			 array = Grow(array, t, b);
+
+		 array->Put(b, value);
+		 // release store而不是release fence + relaxed store, 效果一样，但是
+		 // ThreadSanitizer可以理解.
+		 bottom_.store(b + 1, std::memory_order_release);
+	 }
+
+	 // 只能在拥有者线程调用. 一次Push |count|个元素, 只发布一次bottom, 偷取者要么
+	 // 看不到这一批，要么全部都能看到.
+	 void PushBatch(const T* values, std::size_t count) {
+		 if (count == 0)
+			 return;
+
+		 const int64_t b = bottom_.load(std::memory_order_relaxed);
+		 const int64_t t = top_.load(std::memory_order_acquire);
+		 Array* array = array_.load(std::memory_order_relaxed);
+		 while (b - t + static_cast<int64_t>(count) >
+				static_cast<int64_t>(array->capacity())) {
+			 array = Grow(array, t, b);
+		 }
+
+		 for (std::size_t i = 0; i < count; ++i)
+			 array->Put(b + static_cast<int64_t>(i), values[i]);
+		 bottom_.store(b + static_cast<int64_t>(count), std::memory_order_release);
+	 }
+
+	 // 只能在拥有者线程调用，从bottom端取出最近Push的元素.
+	 bool TryPop(T* value) {
+		 const int64_t b = bottom_.load(std::memory_order_relaxed) - 1;
+		 Array* array = array_.load(std::memory_order_relaxed);
+		 bottom_.store(b, std::memory_order_relaxed);
+		 std::atomic_thread_fence(std::memory_order_seq_cst);
+		 int64_t t = top_.load(std::memory_order_relaxed);
+
+		 if (t > b) {
+			 // 队列是空的，恢复bottom.
+			 bottom_.store(b + 1, std::memory_order_relaxed);
+			 return false;
+		 }
+
+		 *value = array->Get(b);
+		 if (t == b) {
+			 // 最后一个元素, 需要和偷取者竞争.
+			 const bool won = top_.compare_exchange_strong(
+				 t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+			 bottom_.store(b + 1, std::memory_order_relaxed);
+			 return won;
+		 }
+		 return true;
+	 }
+
+	 // 可以在任意线程调用，从top端偷取最早Push的元素.
+	 bool TrySteal(T* value) {
+		 int64_t t = top_.load(std::memory_order_acquire);
+		 std::atomic_thread_fence(std::memory_order_seq_cst);
+		 const int64_t b = bottom_.load(std::memory_order_acquire);
+		 if (t >= b)
+			 return false;
+
+		 Array* array = array_.load(std::memory_order_acquire);
+		 T stolen = array->Get(t);
+		 if (!top_.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst,
+										   std::memory_order_relaxed)) {
+			 // 被其他的偷取者或者拥有者抢先了.
+			 return false;
+		 }
+		 *value = stolen;
+		 return true;
+	 }
+
+	 // 只是一个近似值，在并发的情况下只能作为提示使用.
+	 std::size_t ApproximateSize() const {
+		 const int64_t b = bottom_.load(std::memory_order_relaxed);
+		 const int64_t t = top_.load(std::memory_order_relaxed);
+		 return b > t ? static_cast<std::size_t>(b - t) : 0;
+	 }
+
+	 bool Empty() const { return ApproximateSize() == 0; }
+
+ private:
+	 class Array {
+	  public:
+		  explicit Array(std::size_t capacity)
+			  : mask_(capacity - 1),
+			    slots_(new std::atomic<T>[capacity]) {}
+
+		  std::size_t capacity() const { return mask_ + 1; }
+
+		  T Get(int64_t index) const {
+			  return slots_[static_cast<std::size_t>(index) & mask_].load(
+				  std::memory_order_relaxed);
+		  }
+
+		  void Put(int64_t index, T value) {
+			  slots_[static_cast<std::size_t>(index) & mask_].store(
+				  value, std::memory_order_relaxed);
+		  }
+
+	  private:
+		  const std::size_t mask_;
+		  std::unique_ptr<std::atomic<T>[]> slots_;
+
+		  DISALLOW_COPY_AND_ASSIGN(Array);
+	 };
+
+	 Array* Grow(Array* old_array, int64_t top, int64_t bottom) {
+		 std::unique_ptr<Array> new_array(new Array(old_array->capacity() * 2));
+		 for (int64_t i = top; i < bottom; ++i)
+			 new_array->Put(i, old_array->Get(i));
+
+		 Array* raw = new_array.get();
+		 arrays_.push_back(std::move(new_array));
+		 array_.store(raw, std::memory_order_release);
+		 return raw;
+	 }
+
+	 // top_ 和 bottom_ 分别被偷取者和拥有者频繁的写，放在不同的cache line上避免
+	 // false sharing.
+	 alignas(64) std::atomic<int64_t> top_;
+	 alignas(64) std::atomic<int64_t> bottom_;
+	 alignas(64) std::atomic<Array*> array_;
+
+	 // 所有分配过的数组，只有拥有者线程会修改.
+	 std::vector<std::unique_ptr<Array>> arrays_;
+
+	 DISALLOW_COPY_AND_ASSIGN(ChaseLevDeque);
+};
+
+// 每一个工作线程私有的任务队列, 拥有者Push/TryPop, 其他线程TrySteal.
+// FunctionWrapper 不是trivially copyable的, 所以这里deque里面保存的是指针.
+// 拥有者自己取出来的任务的指针会缓存起来给下一次Push用, 所以拥有者自己Push然后
+// 自己TryPop的时候不会有堆分配, 只有被偷走的任务才需要重新分配.
 class WorkStaealinggQueue {
 	 using Data = base::FunctionWrapper;
  public:
-	 WorkStaealinggQueue() = default;
+	 WorkStaealinggQueue() {
+		 free_boxes_.reserve(kMaxFreeBoxes);
+	 }
+
+	 ~WorkStaealinggQueue() {
+		 Data* data = nullptr;
+		 while (deque_.TryPop(&data))
+			 delete data;
+		 for (Data* box : free_boxes_)
+			 delete box;
+	 }
 
 	 void Push(Data data) {
-		 std::lock_guard<std::mutex> lock(mutex_);
-		 queue_.push_front(std::move(data));
+		 Data* box;
+		 if (!free_boxes_.empty()) {
+			 box = free_boxes_.back();
+			 free_boxes_.pop_back();
+			 *box = std::move(data);
+		 }
+		 else {
+			 box = new Data(std::move(data));
+		 }
+		 deque_.Push(box);
+	 }
+
+	 // 一次发布一批任务, |tasks|里面的任务会被移走.
+	 void PushBatch(Data* tasks, std::size_t count) {
+		 batch_boxes_.clear();
+		 for (std::size_t i = 0; i < count; ++i) {
+			 Data* box;
+			 if (!free_boxes_.empty()) {
+				 box = free_boxes_.back();
+				 free_boxes_.pop_back();
+				 *box = std::move(tasks[i]);
+			 }
+			 else {
+				 box = new Data(std::move(tasks[i]));
+			 }
+			 batch_boxes_.push_back(box);
+		 }
+		 deque_.PushBatch(batch_boxes_.data(), batch_boxes_.size());
 	 }
 
 	 bool Empty() const {
-		 std::lock_guard<std::mutex> lock(mutex_);
-		 queue_.empty();
+		 return deque_.Empty();
+	 }
+
+	 std::size_t ApproximateSize() const {
+		 return deque_.ApproximateSize();
 	 }
 
 	 bool TryPop(Data& res) {
-		 std::lock_guard<std::mutex> lock(mutex_);
-		 if (queue_.empty())
+		 Data* data = nullptr;
+		 if (!deque_.TryPop(&data))
 			 return false;
 
-		 res = std::move(queue_.front());
-		 queue_.pop_front();
+		 res = std::move(*data);
+		 if (free_boxes_.size() < kMaxFreeBoxes)
+			 free_boxes_.push_back(data);
+		 else
+			 delete data;
 		 return true;
 	 }
 
 	 bool TrySteal(Data& res) {
-		 std::lock_guard<std::mutex> lock(mutex_);
-		 if (queue_.empty())
+		 Data* data = nullptr;
+		 if (!deque_.TrySteal(&data))
+			 return false;
+
+		 res = std::move(*data);
+		 delete data;
+		 return true;
+	 }
+
+	 // 偷取一个任务放到|res|, 然后再把这个队列里剩下任务的大约一半(最多
+	 // kMaxStealBatch个)搬到|thief|里面. |thief|必须是调用线程自己的队列.
+	 //
+	 // Chase-Lev deque里面拥有者从bottom端Pop的时候，只要不是最后一个元素就不会
+	 // CAS, 所以偷取者不能一次CAS把top向前移动多个位置(可能和拥有者拿到同一个
+	 // 元素). 这里还是一个一个的偷，但是盒子直接转移给|thief|, 不需要重新分配,
+	 // 并且只发布一次|thief|的bottom.
+	 bool StealHalfInto(WorkStaealinggQueue* thief, Data& res) {
+		 const std::size_t size = deque_.ApproximateSize();
+		 Data* data = nullptr;
+		 if (!deque_.TrySteal(&data))
 			 return false;
 
-		 res = std::move(queue_.back());
-		 queue_.pop_back();
+		 std::size_t extra = size / 2 > 1 ? size / 2 - 1 : 0;
+		 if (extra > kMaxStealBatch)
+			 extra = kMaxStealBatch;
+		 std::vector<Data*>& boxes = thief->batch_boxes_;
+		 boxes.clear();
+		 for (std::size_t i = 0; i < extra; ++i) {
+			 Data* box = nullptr;
+			 if (!deque_.TrySteal(&box))
+				 break;
+			 boxes.push_back(box);
+		 }
+		 thief->deque_.PushBatch(boxes.data(), boxes.size());
+
+		 res = std::move(*data);
+		 delete data;
 		 return true;
 	 }
  private:
-	 std::deque<Data> queue_;
-	 mutable std::mutex mutex_;
+	 static constexpr std::size_t kMaxFreeBoxes = 256;
+	 static constexpr std::size_t kMaxStealBatch = 64;
+
+	 ChaseLevDeque<Data*> deque_;
+
+	 // 只有拥有者线程访问.
+	 std::vector<Data*> free_boxes_;
+	 // PushBatch()用的临时数组, 保留下来避免每次分配.
+	 std::vector<Data*> batch_boxes_;
+
+	 DISALLOW_COPY_AND_ASSIGN(WorkStaealinggQueue);
 };
 
 }	// namespace internal